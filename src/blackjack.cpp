@@ -4,7 +4,7 @@
 //
 // Rules and assumptions:
 //     There is 1 dealer.
-//     There is only 1 player.
+//     There is only 1 player (headless simulations may seat 1 to 7 players).
 //     The dealing shoe contains 1 standard 52-card deck.
 //     A Blackjack game consists of 1 or more rounds.
 //     The deck is shuffled between each round.
@@ -12,9 +12,12 @@
 //     The player must bet at least 1 chip each hand.
 //     There is no limit to maximum bet.
 //     Side bets are not allowed.
-//     Doubling down, splitting, and surrendering are not supported.
+//     The player may double down on any 2-card hand (also after splitting).
+//     The player may split pairs up to 3 times; split aces get 1 card each.
+//     The player may surrender their initial hand for half of their bet.
 //     The dealer should hit until his hand value is 17 or greater.
 //     The dealer must stand on soft-17.
+//     The dealer does not check the hole card for a natural.
 //     Two aces count as 12.
 //     All wins are paid out at 1:1 (i.e., equal to the bet).
 
@@ -24,6 +27,42 @@
 #include <algorithm>
 #include <limits>
 #include <exception>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <coroutine>
+#include <string_view>
+#include <charconv>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <mutex>
+#include <type_traits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifndef BLACKJACK_INSTRUMENTATION
+#define BLACKJACK_INSTRUMENTATION 0 // see PhaseInstrumentation
+#endif
+
+#ifndef BLACKJACK_ALLOCATION_COUNTING
+#define BLACKJACK_ALLOCATION_COUNTING BLACKJACK_INSTRUMENTATION // see numberOfHeapAllocationsOfThread
+#endif
+
+#if BLACKJACK_INSTRUMENTATION && !BLACKJACK_ALLOCATION_COUNTING
+#error "The instrumentation counts heap allocations: BLACKJACK_ALLOCATION_COUNTING cannot be 0."
+#endif
 
 class CustomExceptionWithErrorMessage: public std::exception {
 private:
@@ -41,6 +80,203 @@ public:
     }
 };
 
+// Number of heap allocations made by each thread, so that the benchmarks (and
+// the per-phase counters, see PhaseTimer) can report allocations per
+// operation. The counter is thread-local, so that counting is a plain
+// increment, without contention between threads.
+// Allocations are only counted when building with
+// -DBLACKJACK_ALLOCATION_COUNTING=1 (or with the instrumentation), which
+// replaces the global operator new and operator delete; otherwise the counter
+// stays 0 and the program keeps the allocator of the standard library.
+thread_local long long numberOfHeapAllocationsOfThread = 0;
+
+#if BLACKJACK_ALLOCATION_COUNTING
+#if defined(_MSC_VER)
+#define BLACKJACK_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define BLACKJACK_NOINLINE __attribute__((noinline))
+#else
+#define BLACKJACK_NOINLINE
+#endif
+
+void* operator new(std::size_t size) {
+    numberOfHeapAllocationsOfThread++;
+    void* allocatedMemory = std::malloc(size == 0 ? 1 : size);
+    if (allocatedMemory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return allocatedMemory;
+}
+
+// Once a replaced operator delete is inlined into a delete expression, GCC
+// sees std::free called on a pointer from operator new and warns about a
+// mismatched deallocation (-Wmismatched-new-delete), although both are
+// replaced here and do pair malloc with free. Keeping the delete operators out
+// of line avoids the false positive.
+BLACKJACK_NOINLINE void operator delete(void* allocatedMemory) noexcept {
+    std::free(allocatedMemory);
+}
+
+BLACKJACK_NOINLINE void operator delete(void* allocatedMemory, std::size_t) noexcept {
+    std::free(allocatedMemory);
+}
+#endif
+
+// Per-phase instrumentation of the rounds of BlackjackGame (build with
+// -DBLACKJACK_INSTRUMENTATION=1). Each thread counts, for every phase, the
+// times it is entered, the time spent, the cards drawn and the heap
+// allocations made, plus the reshuffles of the shoe. A thread adds its
+// counters to the process totals when it exits, and the totals are written to
+// stderr as JSON when the program exits. Phases may nest (e.g., a reshuffle
+// during the deal): cards are counted in the innermost phase, while time and
+// allocations also count in the enclosing phase.
+// Without instrumentation, the BLACKJACK_INSTRUMENT_... macros compile to
+// nothing.
+enum InstrumentedPhase {
+    ShufflePhase,
+    InitialDealPhase,
+    PlayerDecisionsPhase,
+    DealerDrawPhase,
+    SettlementPhase,
+    OutsideOfPhases, // e.g., cards drawn by the other engines
+    numberOfInstrumentedPhases
+};
+
+#if BLACKJACK_INSTRUMENTATION
+struct PhaseCounters {
+    long long numberOfTimesEntered[numberOfInstrumentedPhases];
+    long long nanosecondsInPhase[numberOfInstrumentedPhases];
+    long long cardsDrawnInPhase[numberOfInstrumentedPhases];
+    long long heapAllocationsInPhase[numberOfInstrumentedPhases];
+    long long numberOfReshuffles;
+
+    PhaseCounters() {
+        for (int phase = 0; phase < numberOfInstrumentedPhases; phase++) {
+            numberOfTimesEntered[phase] = 0;
+            nanosecondsInPhase[phase] = 0;
+            cardsDrawnInPhase[phase] = 0;
+            heapAllocationsInPhase[phase] = 0;
+        }
+        numberOfReshuffles = 0;
+    }
+
+    void addCounters(const PhaseCounters& otherCounters) {
+        for (int phase = 0; phase < numberOfInstrumentedPhases; phase++) {
+            numberOfTimesEntered[phase] += otherCounters.numberOfTimesEntered[phase];
+            nanosecondsInPhase[phase] += otherCounters.nanosecondsInPhase[phase];
+            cardsDrawnInPhase[phase] += otherCounters.cardsDrawnInPhase[phase];
+            heapAllocationsInPhase[phase] += otherCounters.heapAllocationsInPhase[phase];
+        }
+        numberOfReshuffles += otherCounters.numberOfReshuffles;
+    }
+};
+
+class PhaseInstrumentation {
+private:
+    struct ThreadCounters {
+        PhaseCounters phaseCounters;
+        InstrumentedPhase currentPhase;
+
+        ThreadCounters() {
+            currentPhase = OutsideOfPhases;
+        }
+
+        ~ThreadCounters() {
+            std::lock_guard<std::mutex> mergedCountersLock(mergedCountersMutex);
+            mergedCounters.addCounters(phaseCounters);
+        }
+    };
+
+    inline static std::mutex mergedCountersMutex;
+    inline static PhaseCounters mergedCounters; // counters of the threads that exited
+
+    static const char* getPhaseName(int phase) {
+        static const char* phaseNames[numberOfInstrumentedPhases] = {
+            "shuffle", "initial_deal", "player_decisions", "dealer_draw", "settlement", "outside_of_phases"
+        };
+        return phaseNames[phase];
+    }
+
+public:
+    static ThreadCounters& getThreadCounters() {
+        thread_local ThreadCounters threadCounters;
+        return threadCounters;
+    }
+
+    static void countCardDrawn() {
+        ThreadCounters& threadCounters = getThreadCounters();
+        threadCounters.phaseCounters.cardsDrawnInPhase[threadCounters.currentPhase]++;
+    }
+
+    static void countReshuffle() {
+        getThreadCounters().phaseCounters.numberOfReshuffles++;
+    }
+
+    // Counters of the threads that exited and of the calling thread.
+    static PhaseCounters getMergedCounters() {
+        std::lock_guard<std::mutex> mergedCountersLock(mergedCountersMutex);
+        PhaseCounters counters = mergedCounters;
+        counters.addCounters(getThreadCounters().phaseCounters);
+        return counters;
+    }
+
+    // Registered with std::atexit, so it runs once every thread has exited.
+    static void dumpCountersInJsonFormat() {
+        PhaseCounters counters;
+        {
+            std::lock_guard<std::mutex> mergedCountersLock(mergedCountersMutex);
+            counters = mergedCounters;
+        }
+        std::fprintf(stderr, "{\"instrumentation\": {\"reshuffles\": %lld, \"phases\": [", counters.numberOfReshuffles);
+        for (int phase = 0; phase < numberOfInstrumentedPhases; phase++) {
+            std::fprintf(stderr, "%s\n  {\"phase\": \"%s\", \"entered\": %lld, \"seconds\": %.6f, \"cards_drawn\": %lld, \"allocations\": %lld}",
+                         phase == 0 ? "" : ",", getPhaseName(phase), counters.numberOfTimesEntered[phase],
+                         counters.nanosecondsInPhase[phase] * 1e-9, counters.cardsDrawnInPhase[phase],
+                         counters.heapAllocationsInPhase[phase]);
+        }
+        std::fprintf(stderr, "\n]}}\n");
+    }
+};
+
+// Counts the scope it is declared in as 1 pass through the phase.
+class PhaseTimer {
+private:
+    InstrumentedPhase timedPhase;
+    InstrumentedPhase enclosingPhase;
+    std::chrono::steady_clock::time_point startTime;
+    long long heapAllocationsAtStart;
+
+public:
+    PhaseTimer(InstrumentedPhase phase) {
+        PhaseInstrumentation::getThreadCounters().phaseCounters.numberOfTimesEntered[phase]++;
+        timedPhase = phase;
+        enclosingPhase = PhaseInstrumentation::getThreadCounters().currentPhase;
+        PhaseInstrumentation::getThreadCounters().currentPhase = phase;
+        heapAllocationsAtStart = numberOfHeapAllocationsOfThread;
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ~PhaseTimer() {
+        std::chrono::steady_clock::duration elapsedTime = std::chrono::steady_clock::now() - startTime;
+        PhaseCounters& phaseCounters = PhaseInstrumentation::getThreadCounters().phaseCounters;
+        phaseCounters.nanosecondsInPhase[timedPhase] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime).count();
+        phaseCounters.heapAllocationsInPhase[timedPhase] += numberOfHeapAllocationsOfThread - heapAllocationsAtStart;
+        PhaseInstrumentation::getThreadCounters().currentPhase = enclosingPhase;
+    }
+};
+
+#define BLACKJACK_INSTRUMENT_PHASE(phase) PhaseTimer phaseTimer(phase)
+#define BLACKJACK_INSTRUMENT_CARD_DRAWN() PhaseInstrumentation::countCardDrawn()
+#define BLACKJACK_INSTRUMENT_RESHUFFLE() PhaseInstrumentation::countReshuffle()
+#else
+#define BLACKJACK_INSTRUMENT_PHASE(phase)
+#define BLACKJACK_INSTRUMENT_CARD_DRAWN()
+#define BLACKJACK_INSTRUMENT_RESHUFFLE()
+#endif
+
 enum CardRank {
     Ace = 0,
     Two = 1,
@@ -64,13 +300,25 @@ enum CardSuit {
     Clubs = 3
 };
 
+// A card is a 1-byte value type: the rank is kept in the low 4 bits and the
+// suit in the high 4 bits, so decks and hands store cards inline.
 class Card {
 private:
-    CardRank cardRank;
-    CardSuit cardSuit;
-    int cardValue;
+    unsigned char cardCode;
+
+    static std::vector<std::string> createCardsInTextFormat() {
+        std::vector<std::string> cardsInTextFormat(Clubs * 16 + King + 1); // up to the highest card code
+        for (int suitInIntegerFormat = Spades; suitInIntegerFormat <= Clubs; suitInIntegerFormat++) {
+            for (int rankInIntegerFormat = Ace; rankInIntegerFormat <= King; rankInIntegerFormat++) {
+                Card card(static_cast<CardRank>(rankInIntegerFormat), static_cast<CardSuit>(suitInIntegerFormat));
+                cardsInTextFormat[card.cardCode] = card.getCardRankInTextFormat() + " of " + card.getCardSuitInTextFormat();
+            }
+        }
+        return cardsInTextFormat;
+    }
 
-    int computeCardValue() {
+public:
+    static constexpr int computeCardValue(CardRank cardRank) {
         int cardValue = 0;
         switch(cardRank) {
             case Ace:
@@ -119,36 +367,51 @@ private:
         return cardValue;
     }
 
-public:
+    Card() {
+        cardCode = 0; // Ace of Spades
+    }
+
     Card(CardRank rank, CardSuit suit) {
-        cardRank = rank;
-        cardSuit = suit;
-        cardValue = computeCardValue();
+        if (rank < Ace || rank > King) {
+            throw CustomExceptionWithErrorMessage("Error: card rank is not identified.");
+        }
+        if (suit < Spades || suit > Clubs) {
+            throw CustomExceptionWithErrorMessage("Error: card suit is not identified.");
+        }
+        cardCode = static_cast<unsigned char>((suit << 4) | rank);
     }
 
     CardRank getCardRank() {
-        return cardRank;
+        return static_cast<CardRank>(cardCode & 0x0F);
     }
 
     CardSuit getCardSuit() {
-        return cardSuit;
+        return static_cast<CardSuit>(cardCode >> 4);
     }
 
     int getCardValue() {
-        return cardValue;
+        return computeCardValue(getCardRank());
+    }
+
+    unsigned char getCardCode() {
+        return cardCode;
     }
 
     // example: "Ace of Hearts"
-    std::string getCardInTextFormat() {
-        std::string rankInText = getCardRankInTextFormat();
-        std::string suitInText = getCardSuitInTextFormat();
-        std::string cardInText = rankInText + " of " + suitInText;
-        return cardInText;
+    // The text of every card is built once (indexed by card code), so no
+    // string is created per call.
+    const std::string& getCardInTextFormat() {
+        static const std::vector<std::string> cardsInTextFormat = createCardsInTextFormat();
+        return cardsInTextFormat[cardCode];
+    }
+
+    void appendCardInTextFormat(std::string& textBuffer) {
+        textBuffer += getCardInTextFormat();
     }
 
     std::string getCardRankInTextFormat() {
         std::string rankInText = "";
-        switch(cardRank) {
+        switch(getCardRank()) {
             case Ace:
                 rankInText = "Ace";
                 break;
@@ -197,7 +460,7 @@ public:
 
     std::string getCardSuitInTextFormat() {
         std::string suitInText = "";
-        switch(cardSuit) {
+        switch(getCardSuit()) {
             case Spades:
                 suitInText = "Spades";
                 break;
@@ -218,7 +481,87 @@ public:
     }
 
     bool isAce() {
-        if (cardRank == Ace) {
+        if (getCardRank() == Ace) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+};
+
+static_assert(sizeof(Card) == 1, "Card is expected to fit in 1 byte.");
+
+// Read-only memory mapping of a whole file.
+class MemoryMappedFile {
+private:
+    const char* fileContents;
+    std::size_t fileSize;
+
+public:
+    MemoryMappedFile(const std::string& filePath) {
+        fileContents = nullptr;
+        fileSize = 0;
+        int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+        if (fileDescriptor < 0) {
+            throw CustomExceptionWithErrorMessage("Error: cannot open file '" + filePath + "'.");
+        }
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) != 0) {
+            close(fileDescriptor);
+            throw CustomExceptionWithErrorMessage("Error: cannot read the size of file '" + filePath + "'.");
+        }
+        fileSize = fileStatus.st_size;
+        if (fileSize > 0) {
+            void* mappedMemory = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (mappedMemory == MAP_FAILED) {
+                close(fileDescriptor);
+                throw CustomExceptionWithErrorMessage("Error: cannot map file '" + filePath + "' into memory.");
+            }
+            fileContents = static_cast<const char*>(mappedMemory);
+        }
+        close(fileDescriptor); // The mapping stays valid after closing the file.
+    }
+
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+    ~MemoryMappedFile() {
+        if (fileContents != nullptr) {
+            munmap(const_cast<char*>(fileContents), fileSize);
+        }
+    }
+
+    const char* getFileContents() {
+        return fileContents;
+    }
+
+    std::size_t getFileSize() {
+        return fileSize;
+    }
+
+    // The file will be read from start to end (more read-ahead by the kernel).
+    void adviseSequentialAccess() {
+        if (fileContents != nullptr) {
+            madvise(const_cast<char*>(fileContents), fileSize, MADV_SEQUENTIAL);
+        }
+    }
+};
+
+// Source of the answers (1 line each) typed by the player, read by
+// BlackjackPresenter.
+class PlayerInputSource {
+public:
+    virtual ~PlayerInputSource() {
+    }
+
+    // Returns false when there is no answer left.
+    virtual bool readPlayerResponse(std::string& playerResponse) = 0;
+};
+
+class ConsoleInputSource: public PlayerInputSource {
+public:
+    bool readPlayerResponse(std::string& playerResponse) {
+        if (getline(std::cin, playerResponse)) {
             return true;
         } else {
             return false;
@@ -226,8 +569,96 @@ public:
     }
 };
 
+// Answers replayed from a script file holding what the player would type,
+// 1 answer per line (bets and y/n decisions), e.g. a recorded customer
+// session. The file is memory-mapped and split into lines once, up front.
+class ScriptedInputSource: public PlayerInputSource {
+private:
+    MemoryMappedFile scriptFile;
+    std::vector<std::string_view> scriptedResponses;
+    std::size_t indexOfNextResponse;
+
+public:
+    ScriptedInputSource(const std::string& scriptFilePath) : scriptFile(scriptFilePath) {
+        std::string_view scriptText(scriptFile.getFileContents(), scriptFile.getFileSize());
+        std::size_t lineStart = 0;
+        while (lineStart < scriptText.size()) {
+            std::size_t lineEnd = scriptText.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos) {
+                lineEnd = scriptText.size();
+            }
+            std::string_view scriptedResponse = scriptText.substr(lineStart, lineEnd - lineStart);
+            if (!scriptedResponse.empty() && scriptedResponse.back() == '\r') {
+                scriptedResponse.remove_suffix(1);
+            }
+            scriptedResponses.push_back(scriptedResponse);
+            lineStart = lineEnd + 1;
+        }
+        indexOfNextResponse = 0;
+    }
+
+    bool readPlayerResponse(std::string& playerResponse) {
+        if (indexOfNextResponse == scriptedResponses.size()) {
+            return false;
+        }
+        playerResponse.assign(scriptedResponses[indexOfNextResponse].data(), scriptedResponses[indexOfNextResponse].size());
+        indexOfNextResponse++;
+        return true;
+    }
+};
+
+// Decision of a player on their current hand.
+enum PlayerDecision {
+    PlayerStandsOnHand,
+    PlayerHitsHand,
+    PlayerDoublesDown,
+    PlayerSplitsPair,
+    PlayerSurrenders
+};
+
+// Decisions the player may take on their current hand, besides hitting and
+// standing.
+struct PlayerDecisionOptions {
+    bool canDoubleDown;
+    bool canSplit;
+    bool canSurrender;
+    int pairCardValue; // 1 (a pair of aces) to 10, if canSplit
+};
+
+// The presenter of the game is also the policy of a human player (see
+// BlackjackGame): it displays the game and asks the player for their decisions
+// on the console.
 class BlackjackPresenter {
 private:
+    bool quietMode; // nothing is displayed (e.g., when replaying sessions)
+    PlayerInputSource* playerInputSource;
+    ConsoleInputSource consoleInputSource;
+    std::string playerResponse; // reused by every answer of the player
+
+    void displayPrompt(const char* prompt) {
+        if (!quietMode) {
+            std::cout << prompt;
+        }
+    }
+
+    void readPlayerResponse() {
+        if (!playerInputSource->readPlayerResponse(playerResponse)) {
+            throw CustomExceptionWithErrorMessage("Error: there is no more input from the player.");
+        }
+    }
+
+    // The bet is the number at the start of the response (leading spaces are
+    // skipped and anything after the number is ignored).
+    bool parsePlayerBet(int& playerBetInChips) {
+        std::size_t numberStart = playerResponse.find_first_not_of(" \t");
+        if (numberStart == std::string::npos) {
+            return false;
+        }
+        const char* responseEnd = playerResponse.data() + playerResponse.size();
+        std::from_chars_result parseResult = std::from_chars(playerResponse.data() + numberStart, responseEnd, playerBetInChips);
+        return parseResult.ec == std::errc();
+    }
+
     std::string appendTrailingCharacterS(int quantity) {
         std::string trailingCharacterS = ""; // singular number ("s" character is not appended)
         if (quantity > 1) {
@@ -237,117 +668,244 @@ private:
     }
 
 public:
+    static const bool displaysTheGame = true;
+
+    BlackjackPresenter() {
+        quietMode = false;
+        playerInputSource = &consoleInputSource;
+    }
+
+    BlackjackPresenter(const BlackjackPresenter&) = delete;
+    BlackjackPresenter& operator=(const BlackjackPresenter&) = delete;
+
+    // The input source is owned by the caller; nullptr restores the console.
+    void setPlayerInputSource(PlayerInputSource* inputSource) {
+        if (inputSource == nullptr) {
+            playerInputSource = &consoleInputSource;
+        } else {
+            playerInputSource = inputSource;
+        }
+    }
+
+    void setQuietMode(bool quiet) {
+        quietMode = quiet;
+    }
+
+    bool isQuiet() {
+        return quietMode;
+    }
+
     void displayWelcomeMessage() {
+        if (quietMode) {
+            return;
+        }
         std::cout << std::endl;
         std::cout << "Welcome to Blackjack! Enjoy your play." << std::endl;
         std::cout << std::endl;
     }
 
     void displayGoodbyeMessage() {
+        if (quietMode) {
+            return;
+        }
         std::cout << std::endl;
         std::cout << "We hope you had a great time and to see you again soon!" << std::endl;
         std::cout << std::endl;
     }
 
     void announceStartOfRound() {
+        if (quietMode) {
+            return;
+        }
         std::cout << std::endl;
         std::cout << "A new Blackjack round begins." << std::endl;
         std::cout << std::endl;
     }
 
     void announceEndOfRound() {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Current Blackjack round is over." << std::endl;
         std::cout << std::endl;
     }
 
     void displayPlayerAvailableChipsToBetWith(int playerChipsToPlay) {
+        if (quietMode) {
+            return;
+        }
         std::string trailingCharacterS = appendTrailingCharacterS(playerChipsToPlay);
         std::cout << "You have " << playerChipsToPlay << " chip" << trailingCharacterS << " to bet with." << std::endl;
     }
 
     int askPlayerToBetChips(int minimumBet, int maximumBet) {
         int playerBetInChips = 0;
-        std::cout << "Place your bet please (minimum bet is 1):  ";
-        while (!(std::cin >> playerBetInChips) || playerBetInChips < minimumBet || playerBetInChips > maximumBet) {
-            std::cout << "Please try to bet again. Your bet should be a number between 1 and up to your available chips:  ";
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        }
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        std::string trailingCharacterS = appendTrailingCharacterS(playerBetInChips);
-        std::cout << "Your bet is " << playerBetInChips << " chip" << trailingCharacterS << "." << std::endl;
+        std::string minimumBetInText = std::to_string(minimumBet);
+        displayPrompt(("Place your bet please (minimum bet is " + minimumBetInText + "):  ").c_str());
+        readPlayerResponse();
+        while (!parsePlayerBet(playerBetInChips) || playerBetInChips < minimumBet || playerBetInChips > maximumBet) {
+            displayPrompt(("Please try to bet again. Your bet should be a number between " + minimumBetInText + " and up to your available chips:  ").c_str());
+            readPlayerResponse();
+        }
+        if (!quietMode) {
+            std::string trailingCharacterS = appendTrailingCharacterS(playerBetInChips);
+            std::cout << "Your bet is " << playerBetInChips << " chip" << trailingCharacterS << "." << std::endl;
+        }
         return playerBetInChips;
     }
 
-    void displayPlayerHand(std::string playerHandInTextFormat) {
+    void displayPlayerHand(const std::string& playerHandInTextFormat) {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Your hand contains:  " << playerHandInTextFormat << std::endl;
     }
 
     void displayPlayerHandValue(int playerHandValue) {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Your hand value is:  " << playerHandValue << std::endl;
     }
 
-    void displayDealerHand(std::string dealerHandInTextFormat) {
+    void displayDealerHand(const std::string& dealerHandInTextFormat) {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Dealer's hand contains:  " << dealerHandInTextFormat << std::endl;
     }
 
     void displayDealerHandValue(int dealerHandValue) {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Dealer's hand value is:  " << dealerHandValue << std::endl;
     }
 
     void announceSecondCardOfDealerIsHidden() {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Dealer's second card remains hidden." << std::endl;
     }
 
-    bool askPlayerForAdditionalCard() {
-        std::cout << "Would you like 1 more card (y/n)?  ";
-        std::string playerResponse = "";
-        getline(std::cin, playerResponse);
-        transform(playerResponse.begin(), playerResponse.end(), playerResponse.begin(), ::tolower);
-        while (!(playerResponse == "y") && !(playerResponse == "yes") && !(playerResponse == "n") && !(playerResponse == "no")) {
-            std::cout << "Would you like 1 more card (y/n)? Please type 'y' or 'n' (without the quotes):  ";
-            getline(std::cin, playerResponse);
+    void announceDealerHasNatural() {
+        if (quietMode) {
+            return;
+        }
+        std::cout << "Dealer checks the second card and has Blackjack." << std::endl;
+    }
+
+    // The player decides from the displayed hands, so the hand values passed
+    // by BlackjackGame are not used. Only the allowed options are offered.
+    PlayerDecision askPlayerForDecision(int /* playerHandValue */, bool /* playerHasSoftHand */, int /* dealerUpcardValue */,
+                                        const PlayerDecisionOptions& decisionOptions) {
+        std::string prompt = "Would you like 1 more card (y/n)";
+        if (decisionOptions.canDoubleDown) {
+            prompt += ", to double down (d)";
+        }
+        if (decisionOptions.canSplit) {
+            prompt += ", to split (p)";
+        }
+        if (decisionOptions.canSurrender) {
+            prompt += ", to surrender (r)";
+        }
+        prompt += "?  ";
+        displayPrompt(prompt.c_str());
+        while (true) {
+            readPlayerResponse();
             transform(playerResponse.begin(), playerResponse.end(), playerResponse.begin(), ::tolower);
+            if (playerResponse == "y" || playerResponse == "yes") {
+                return PlayerHitsHand;
+            }
+            if (playerResponse == "n" || playerResponse == "no") {
+                return PlayerStandsOnHand;
+            }
+            if (playerResponse == "d" && decisionOptions.canDoubleDown) {
+                return PlayerDoublesDown;
+            }
+            if (playerResponse == "p" && decisionOptions.canSplit) {
+                return PlayerSplitsPair;
+            }
+            if (playerResponse == "r" && decisionOptions.canSurrender) {
+                return PlayerSurrenders;
+            }
+            displayPrompt("Please type 1 of the letters in parentheses (without the parentheses):  ");
         }
-        bool playerWantsToGetOneAdditionalCard = false;
-        if (playerResponse == "y" || playerResponse == "yes") {
-            playerWantsToGetOneAdditionalCard = true;
+    }
+
+    // Once the player has split, each hand is announced when it is played
+    // and when it is settled.
+    void announcePlayerHandNumber(int handNumber, int numberOfHands) {
+        if (quietMode) {
+            return;
         }
-        if (playerResponse == "n" || playerResponse == "no") {
-            playerWantsToGetOneAdditionalCard = false;
+        std::cout << "Your hand " << handNumber << " of " << numberOfHands << ":" << std::endl;
+    }
+
+    void announcePlayerDoublesDown() {
+        if (quietMode) {
+            return;
+        }
+        std::cout << "You double your bet and take 1 more card." << std::endl;
+    }
+
+    void announcePlayerSplitsPair() {
+        if (quietMode) {
+            return;
+        }
+        std::cout << "You split your pair into 2 hands." << std::endl;
+    }
+
+    void announcePlayerSurrenders() {
+        if (quietMode) {
+            return;
         }
-        return playerWantsToGetOneAdditionalCard;
+        std::cout << "You surrender and get half of your bet back." << std::endl;
     }
 
     void announcePlayerWins() {
+        if (quietMode) {
+            return;
+        }
         std::cout << "You win." << std::endl;
     }
 
     void announcePlayerPushes() {
+        if (quietMode) {
+            return;
+        }
         std::cout << "You push." << std::endl;
     }
 
     void announcePlayerLoses() {
+        if (quietMode) {
+            return;
+        }
         std::cout << "You lose." << std::endl;
     }
 
     void displayPlayerCurrentNumberOfChips(int currentNumberOfChips) {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Your current number of chips is " << currentNumberOfChips << "." << std::endl;
     }
 
     void displayRegretMessageNoChips() {
+        if (quietMode) {
+            return;
+        }
         std::cout << "Sorry but you have no more chips to bet with." << std::endl;
     }
 
     bool askPlayerToPlayNewRound() {
-        std::cout << "Would you like to play another round (y/n)?  ";
-        std::string playerResponse = "";
-        getline(std::cin, playerResponse);
+        displayPrompt("Would you like to play another round (y/n)?  ");
+        readPlayerResponse();
         transform(playerResponse.begin(), playerResponse.end(), playerResponse.begin(), ::tolower);
         while (!(playerResponse == "y") && !(playerResponse == "yes") && !(playerResponse == "n") && !(playerResponse == "no")) {
-            std::cout << "Would you like to play another round (y/n)? Please type 'y' or 'n' (without the quotes):  ";
-            getline(std::cin, playerResponse);
+            displayPrompt("Would you like to play another round (y/n)? Please type 'y' or 'n' (without the quotes):  ");
+            readPlayerResponse();
             transform(playerResponse.begin(), playerResponse.end(), playerResponse.begin(), ::tolower);
         }
         bool playerWantsToPlayNewRound = false;
@@ -361,587 +919,4996 @@ public:
     }
 };
 
-class Hand {
-private:
-    std::vector<Card*> cardsInHand;
+// House rules are compile-time policies: BlackjackGame (and the engines that
+// drive it) is templated on a ruleset, so that each ruleset compiles into its
+// own engine with the rule checks folded away. A ruleset provides:
+//     static constexpr const char* rulesName
+//     static constexpr int numberOfDecks                  default number of decks in the dealing shoe
+//     static constexpr bool dealerHitsSoft17              otherwise the dealer stands on soft-17
+//     static constexpr bool blackjackPaysThreeToTwo       otherwise a blackjack is paid at 1:1 like any win
+//     static constexpr bool dealerPeeksForNatural         a dealer's natural under an ace or 10 upcard ends the round at once
+//     static constexpr bool doublingDownIsAllowed
+//     static constexpr bool doublingDownAfterSplitIsAllowed
+//     static constexpr int maximumNumberOfHands           hands after splitting, 1 (no splitting) to 4
+//     static constexpr bool surrenderIsAllowed
+//     static constexpr int minimumBet
 
-    bool handContainsAce() {
-        if (isHandEmpty()) {
-            return false;
-        }
-        bool aceExists = false;
-        for (int handIndex = 0; handIndex < cardsInHand.size(); handIndex++) {
-            Card* currentCard = cardsInHand[handIndex];
-            if (currentCard->isAce()) {
-                aceExists = true;
-            }
-        }
-        return aceExists;
-    }
+// The rules of this game (see the top of this file).
+struct ClassicHouseRules {
+    static constexpr const char* rulesName = "classic";
+    static constexpr int numberOfDecks = 1;
+    static constexpr bool dealerHitsSoft17 = false;
+    static constexpr bool blackjackPaysThreeToTwo = false;
+    static constexpr bool dealerPeeksForNatural = false;
+    static constexpr bool doublingDownIsAllowed = true;
+    static constexpr bool doublingDownAfterSplitIsAllowed = true;
+    static constexpr int maximumNumberOfHands = 4;
+    static constexpr bool surrenderIsAllowed = true;
+    static constexpr int minimumBet = 1;
+};
 
-public:
-    ~Hand() {
-        if (!isHandEmpty()) {
-            clearHand();
-        }
-    }
+// A typical 6-deck shoe game of the Las Vegas Strip.
+struct LasVegasStripHouseRules {
+    static constexpr const char* rulesName = "vegas-strip";
+    static constexpr int numberOfDecks = 6;
+    static constexpr bool dealerHitsSoft17 = false;
+    static constexpr bool blackjackPaysThreeToTwo = true;
+    static constexpr bool dealerPeeksForNatural = true;
+    static constexpr bool doublingDownIsAllowed = true;
+    static constexpr bool doublingDownAfterSplitIsAllowed = true;
+    static constexpr int maximumNumberOfHands = 4;
+    static constexpr bool surrenderIsAllowed = true;
+    static constexpr int minimumBet = 2;
+};
 
-    bool isHandEmpty() {
-        return cardsInHand.empty();
-    }
+// A typical 2-deck game of downtown Las Vegas: the dealer hits soft-17, a pair
+// may be split only once and there is no surrender.
+struct DowntownHouseRules {
+    static constexpr const char* rulesName = "downtown";
+    static constexpr int numberOfDecks = 2;
+    static constexpr bool dealerHitsSoft17 = true;
+    static constexpr bool blackjackPaysThreeToTwo = true;
+    static constexpr bool dealerPeeksForNatural = true;
+    static constexpr bool doublingDownIsAllowed = true;
+    static constexpr bool doublingDownAfterSplitIsAllowed = false;
+    static constexpr int maximumNumberOfHands = 2;
+    static constexpr bool surrenderIsAllowed = false;
+    static constexpr int minimumBet = 1;
+};
 
-    int getNumberOfCardsInHand() {
-        return cardsInHand.size();
-    }
+// Every hand is in 1 of 43 states, whatever its cards: a hard hand value of 0
+// to 31 (no ace counting as 11), or a soft hand value (1 ace counting as 11)
+// with a hard hand value of 1 to 11. Once the hard hand value is above 11, an
+// ace can never count as 11 again, so the state and the next card decide the
+// next state. A hand below 21 cannot go above 31; any higher hard hand value
+// would be kept at 31, which is busted all the same.
+// The next state for every state and card rank, the hand value of every state
+// and its soft and bust bits are computed at compile time (HandStateDerivation)
+// and read by Hand, so the running state of a hand is 1 byte and adding a
+// card to it is 1 table load (the cards themselves are kept for display).
+// Dealer keeps its stand bits per state in the same way.
+struct HandStateTable {
+    static const int numberOfHandStates = 43;
+    static const int numberOfCardRanks = King + 1;
+    std::uint8_t nextHandState[numberOfHandStates][numberOfCardRanks];
+    std::uint8_t handValueOfState[numberOfHandStates];
+    std::uint64_t softHandStates; // 1 bit per hand state
+    std::uint64_t bustedHandStates;
+};
 
-    int getHandValue() {
-        if (isHandEmpty()) {
-            return 0;
-        }
-        int handValue = 0;
-        for (int handIndex = 0; handIndex < cardsInHand.size(); handIndex++) {
-            handValue += cardsInHand[handIndex]->getCardValue();
-        }
-        if (handContainsAce() && handValue <= 11) {
+class HandStateDerivation {
+public:
+    static const int highestHardHandState = 31;
+    static const int firstSoftHandState = highestHardHandState + 1; // soft hand with a hard hand value of 1
+
+    // Hand value given the sum of the cards (every ace counting as 1) and
+    // whether the hand contains an ace: 1 ace may count as 11 instead.
+    static constexpr int computeHandValue(int hardHandValue, bool aceExists) {
+        int handValue = hardHandValue;
+        if (aceExists && handValue <= 11) {
             handValue += 10; // Two aces count as 12.
         }
         return handValue;
     }
 
-    std::string getHandInTextFormat() {
-        if (isHandEmpty()) {
-            return "";
-        }
-        std::string handInTextFormat = "";
-        for (int handIndex = 0; handIndex < cardsInHand.size(); handIndex++) {
-            Card* currentCard = cardsInHand[handIndex];
-            handInTextFormat += currentCard->getCardInTextFormat();
-            handInTextFormat += " | ";
+    static constexpr int computeHandState(int hardHandValue, bool aceExists) {
+        if (aceExists && hardHandValue >= 1 && hardHandValue <= 11) {
+            return firstSoftHandState + hardHandValue - 1;
+        } else if (hardHandValue > highestHardHandState) {
+            return highestHardHandState;
+        } else {
+            return hardHandValue;
         }
-        return handInTextFormat;
-    }
-
-    void addCardToHand(Card* newCard) {
-        cardsInHand.push_back(newCard);
     }
 
-    // The cards in hand are discarded.
-    void clearHand() {
-        if (isHandEmpty()) {
-            return;
-        }
-        for (int handIndex = 0; handIndex < cardsInHand.size(); handIndex++) {
-            delete cardsInHand[handIndex];
-            cardsInHand[handIndex] = nullptr;
+    static constexpr HandStateTable createHandStateTable() {
+        HandStateTable handStateTable = {};
+        for (int handState = 0; handState < HandStateTable::numberOfHandStates; handState++) {
+            bool softHand = handState >= firstSoftHandState;
+            int hardHandValue = softHand ? handState - firstSoftHandState + 1 : handState;
+            int handValue = computeHandValue(hardHandValue, softHand);
+            handStateTable.handValueOfState[handState] = static_cast<std::uint8_t>(handValue);
+            if (softHand) {
+                handStateTable.softHandStates |= 1ULL << handState;
+            }
+            if (handValue > 21) {
+                handStateTable.bustedHandStates |= 1ULL << handState;
+            }
+            for (int cardRank = Ace; cardRank <= King; cardRank++) {
+                int cardValue = Card::computeCardValue(static_cast<CardRank>(cardRank));
+                handStateTable.nextHandState[handState][cardRank] =
+                    static_cast<std::uint8_t>(computeHandState(hardHandValue + cardValue, softHand || cardValue == 1));
+            }
         }
-        cardsInHand.clear();
+        return handStateTable;
     }
 };
 
-class GenericPlayer {
-protected:
-    Hand genericPlayerHand;
+class HandStates {
+private:
+    static constexpr HandStateTable handStateTable = HandStateDerivation::createHandStateTable();
 
 public:
-    virtual ~GenericPlayer() {
+    static const std::uint8_t emptyHandState = 0;
+
+    static std::uint8_t addCard(std::uint8_t handState, Card newCard) {
+        return handStateTable.nextHandState[handState][newCard.getCardRank()];
     }
 
-    int getHandValue() {
-        return genericPlayerHand.getHandValue();
+    static int getHandValue(std::uint8_t handState) {
+        return handStateTable.handValueOfState[handState];
     }
 
-    std::string getHandInTextFormat() {
-        return genericPlayerHand.getHandInTextFormat();
+    static constexpr bool isSoftHand(int handState) {
+        return (handStateTable.softHandStates >> handState) & 1;
     }
 
-    void isHitting(Card* newCard) {
-        genericPlayerHand.addCardToHand(newCard);
+    static bool isBusted(std::uint8_t handState) {
+        return (handStateTable.bustedHandStates >> handState) & 1;
     }
 
-    bool isBusted() {
-        if (genericPlayerHand.getHandValue() > 21) {
-            return true;
-        } else {
-            return false;
-        }
+    static constexpr int getHandValueOfState(int handState) {
+        return handStateTable.handValueOfState[handState];
     }
+};
 
-    bool hasBlackjack() {
-        if (genericPlayerHand.getHandValue() == 21) {
-            return true;
-        } else {
-            return false;
-        }
+class Hand {
+private:
+    // A hand whose value is below 21 can take 1 more card, so even a run of
+    // aces cannot hold more than 21 cards.
+    static const int maximumNumberOfCardsInHand = 21;
+    Card cardsInHand[maximumNumberOfCardsInHand];
+    std::uint8_t numberOfCardsInHand; // at most 21, so all members are bytes
+    // Running state of the hand (see HandStates), updated as each card is
+    // added, so that the hand value is read in constant time.
+    std::uint8_t handState;
+
+public:
+    Hand() {
+        numberOfCardsInHand = 0;
+        handState = HandStates::emptyHandState;
     }
 
-    // The cards in hand are discarded.
-    void clearHand() {
-        genericPlayerHand.clearHand();
+    bool isHandEmpty() {
+        return numberOfCardsInHand == 0;
     }
-};
 
-class Dealer: public GenericPlayer {
-public:
-    bool handValueIsAtLeast17() {
-        int dealerHandValue = getHandValue();
-        if (dealerHandValue >= 17) {
-            return true;
-        } else {
-            return false;
-        }
+    int getNumberOfCardsInHand() {
+        return numberOfCardsInHand;
     }
-};
 
-class Player: public GenericPlayer {
-private:
-    int chipsToPlay;
-    int chipsInBettingBox;
-    static const int minimumBet = 1; // The player should bet at least 1 chip.
+    // Hand value given the sum of the cards (every ace counting as 1) and
+    // whether the hand contains an ace: 1 ace may count as 11 instead.
+    static constexpr int computeHandValue(int hardHandValue, bool aceExists) {
+        return HandStateDerivation::computeHandValue(hardHandValue, aceExists);
+    }
 
-public:
-    Player() {
-        chipsToPlay = 0;
-        buyChips(100); // The player starts with 100 chips.
-        chipsInBettingBox = 0;
+    std::uint8_t getHandState() {
+        return handState;
     }
 
-    void buyChips(int newChips) {
-        chipsToPlay += newChips;
+    int getHandValue() {
+        return HandStates::getHandValue(handState);
     }
 
-    int getCurrentNumberOfChipsToPlay() {
-        return chipsToPlay;
+    // A soft hand counts 1 ace as 11.
+    bool isSoftHand() {
+        return HandStates::isSoftHand(handState);
     }
 
-    bool hasAvailableChipsToPlay() {
-        if (chipsToPlay >= 1) {
-            return true;
-        } else {
-            return false;
-        }
+    bool isBusted() {
+        return HandStates::isBusted(handState);
     }
 
-    void isBetting(int chipsToBet) {
-        if (chipsToBet > getCurrentNumberOfChipsToPlay()) {
-            throw CustomExceptionWithErrorMessage("Error: player is trying to bet more than their available chips.");
-        }
-        if (chipsToBet < getMinimumBet()) {
-            throw CustomExceptionWithErrorMessage("Error: player is trying to bet less than the minimum bet of 1 chip.");
-        }
-        chipsToPlay -= chipsToBet;
-        chipsInBettingBox += chipsToBet;
+    Card getCardAtPosition(int handIndex) {
+        return cardsInHand[handIndex];
     }
 
-    int getMinimumBet() {
-        return minimumBet;
+    std::string getHandInTextFormat() {
+        std::string handInTextFormat = "";
+        appendHandInTextFormat(handInTextFormat);
+        return handInTextFormat;
+    }
+
+    // Appends into a caller-provided buffer, which does not allocate once the
+    // buffer has grown to the length of a hand.
+    void appendHandInTextFormat(std::string& textBuffer) {
+        for (int handIndex = 0; handIndex < numberOfCardsInHand; handIndex++) {
+            cardsInHand[handIndex].appendCardInTextFormat(textBuffer);
+            textBuffer += " | ";
+        }
     }
 
-    void wins() {
-        int chipsWon = chipsInBettingBox; // All wins are paid out at 1:1.
-        chipsToPlay += chipsInBettingBox + chipsWon;
-        chipsInBettingBox = 0;
+    void addCardToHand(Card newCard) {
+        if (numberOfCardsInHand == maximumNumberOfCardsInHand) {
+            throw CustomExceptionWithErrorMessage("Error: cannot add card to a full hand.");
+        }
+        cardsInHand[numberOfCardsInHand] = newCard;
+        numberOfCardsInHand++;
+        handState = HandStates::addCard(handState, newCard);
     }
 
-    void pushes() {
-        chipsToPlay += chipsInBettingBox; // Bet is returned (without adjustment) to the player.
-        chipsInBettingBox = 0;
+    // Takes back the last card (e.g., the 2nd card of a pair being split).
+    Card removeLastCardFromHand() {
+        if (numberOfCardsInHand == 0) {
+            throw CustomExceptionWithErrorMessage("Error: cannot remove card from an empty hand.");
+        }
+        numberOfCardsInHand--;
+        Card removedCard = cardsInHand[numberOfCardsInHand];
+        // A state cannot be stepped back, so the remaining cards are replayed.
+        handState = HandStates::emptyHandState;
+        for (int handIndex = 0; handIndex < numberOfCardsInHand; handIndex++) {
+            handState = HandStates::addCard(handState, cardsInHand[handIndex]);
+        }
+        return removedCard;
     }
 
-    void loses() {
-        chipsInBettingBox = 0; // Bet is lost (i.e., taken by the dealer).
+    // The cards in hand are discarded.
+    void clearHand() {
+        numberOfCardsInHand = 0;
+        handState = HandStates::emptyHandState;
     }
 };
 
-class Deck {
-private:
-    std::vector<Card*> cardsInDeck;
-    static const int totalNumberOfCardsInCompleteDeck = 52;
+static_assert(sizeof(Hand) == 23, "A hand is expected to fit in 23 bytes (21 cards, their number and the state).");
 
-    void createOrderedCardsOfSuit(CardSuit suit) {
-        for (int rankInIntegerFormat = Ace; rankInIntegerFormat <= King; rankInIntegerFormat++) {
-            CardRank rank = static_cast<CardRank>(rankInIntegerFormat);
-            try {
-                Card* newCard = new Card(rank, suit);
-                cardsInDeck.push_back(newCard);
-            }
-            catch (const std::bad_alloc& e) {
-                throw CustomExceptionWithErrorMessage("Error: the system is unable to satisfy request for memory.");
-            }
+// A hand holder such as the dealer (the players of a table are kept in
+// SeatArrays instead), holding up to maximumNumberOfHands hands (more than 1
+// only after splitting pairs). Hands are stored inline, so that splitting
+// never allocates. The methods below act on the current hand.
+template <int maximumNumberOfHands>
+class GenericPlayer {
+protected:
+    Hand genericPlayerHands[maximumNumberOfHands];
+    int numberOfHands;
+    int indexOfCurrentHand;
+
+    Hand& getCurrentHand() {
+        if constexpr (maximumNumberOfHands == 1) {
+            return genericPlayerHands[0];
+        } else {
+            return genericPlayerHands[indexOfCurrentHand];
         }
     }
 
 public:
-    Deck() {
-        cardsInDeck.reserve(52);
-        createOrderedDeck();
+    GenericPlayer() {
+        numberOfHands = 1;
+        indexOfCurrentHand = 0;
     }
 
-    ~Deck() {
-        clearDeck();
+    int getNumberOfHands() {
+        return numberOfHands;
     }
 
-    // Discard cards (if any) in deck and create an ordered deck of cards.
-    void createOrderedDeck() {
-        clearDeck();
-        createOrderedCardsOfSuit(Spades);
-        createOrderedCardsOfSuit(Hearts);
-        createOrderedCardsOfSuit(Diamonds);
-        createOrderedCardsOfSuit(Clubs);
+    int getIndexOfCurrentHand() {
+        return indexOfCurrentHand;
     }
 
-    // The deck of cards is discarded.
-    void clearDeck() {
-        if (isDeckEmpty()) {
-            return;
+    void selectHand(int handIndex) {
+        if (handIndex < 0 || handIndex >= numberOfHands) {
+            throw CustomExceptionWithErrorMessage("Error: there is no such hand to select.");
         }
-        for (int deckIndex = 0; deckIndex < getCurrentNumberOfCardsInDeck(); deckIndex++) {
-            delete cardsInDeck[deckIndex];
-            cardsInDeck[deckIndex] = nullptr;
-        }
-        cardsInDeck.clear();
+        indexOfCurrentHand = handIndex;
     }
 
-    bool isDeckEmpty() {
-        return cardsInDeck.empty();
+    int getHandValue() {
+        return getCurrentHand().getHandValue();
     }
 
-    int getCurrentNumberOfCardsInDeck() {
-        return cardsInDeck.size();
+    std::string getHandInTextFormat() {
+        return getCurrentHand().getHandInTextFormat();
+    }
+
+    void appendHandInTextFormat(std::string& textBuffer) {
+        getCurrentHand().appendHandInTextFormat(textBuffer);
     }
 
-    void shuffleDeck() {
-        if (!isDeckEmpty()) {
-            random_shuffle(cardsInDeck.begin(), cardsInDeck.end());
+    void isHitting(Card newCard) {
+        getCurrentHand().addCardToHand(newCard);
+    }
+
+    bool hasSoftHand() {
+        return getCurrentHand().isSoftHand();
+    }
+
+    bool isBusted() {
+        return getCurrentHand().isBusted();
+    }
+
+    bool hasBlackjack() {
+        if (getCurrentHand().getHandValue() == 21) {
+            return true;
+        } else {
+            return false;
         }
     }
 
-    Card* drawCardfromDeck() {
-        if (isDeckEmpty()) {
-            throw CustomExceptionWithErrorMessage("Error: cannot draw card from an empty deck.");
+    // A natural is a 21 on the first 2 cards (a split hand is never 1).
+    bool hasNaturalBlackjack() {
+        if (numberOfHands == 1 && getCurrentHand().getNumberOfCardsInHand() == 2 && getCurrentHand().getHandValue() == 21) {
+            return true;
         } else {
-            Card* removedCard = cardsInDeck.back();
-            cardsInDeck.pop_back();
-            return removedCard;
+            return false;
         }
     }
 
-    void displayCardsInDeckInTextFormat() {
-        int currentNumberOfCardsInDeck = getCurrentNumberOfCardsInDeck();
-        std::string trailingCharacterS = ""; // singular number ("s" character is not appended)
-        if (currentNumberOfCardsInDeck > 1) {
-            trailingCharacterS = "s"; // plural number ("s" character is appended)
+    int getNumberOfCardsInHand() {
+        return getCurrentHand().getNumberOfCardsInHand();
+    }
+
+    Card getCardAtPosition(int handIndex) {
+        return getCurrentHand().getCardAtPosition(handIndex);
+    }
+
+    // The cards in every hand are discarded, leaving 1 empty hand.
+    void clearHand() {
+        for (int handIndex = 0; handIndex < numberOfHands; handIndex++) {
+            genericPlayerHands[handIndex].clearHand();
         }
-        std::cout << "The deck contains " << currentNumberOfCardsInDeck << " card" << trailingCharacterS << "." << std::endl;
-        if (isDeckEmpty()) {
-            return;
+        numberOfHands = 1;
+        indexOfCurrentHand = 0;
+    }
+};
+
+template <typename HouseRules = ClassicHouseRules>
+class Dealer: public GenericPlayer<1> {
+public:
+    // The dealer hits until their hand value is 17 or greater, and also hits
+    // a soft-17 if the house rules say so.
+    static constexpr bool standsOnHand(int dealerHandValue, bool dealerHasSoftHand) {
+        if constexpr (HouseRules::dealerHitsSoft17) {
+            if (dealerHandValue > 17 || (dealerHandValue == 17 && !dealerHasSoftHand)) {
+                return true;
+            } else {
+                return false;
+            }
         } else {
-            for (int deckIndex = 0; deckIndex < currentNumberOfCardsInDeck; deckIndex++) {
-                std::cout << cardsInDeck[deckIndex]->getCardInTextFormat() << std::endl;
+            if (dealerHandValue >= 17) {
+                return true;
+            } else {
+                return false;
             }
         }
     }
-};
 
-class BlackjackGame {
 private:
-    Dealer dealer;
-    Player player;
-    Deck deck;
-    BlackjackPresenter blackjackPresenter;
+    // Whether the dealer stands, 1 bit per hand state (see HandStates).
+    static constexpr std::uint64_t createStandingHandStates() {
+        std::uint64_t standingHandStates = 0;
+        for (int handState = 0; handState < HandStateTable::numberOfHandStates; handState++) {
+            if (standsOnHand(HandStates::getHandValueOfState(handState), HandStates::isSoftHand(handState))) {
+                standingHandStates |= 1ULL << handState;
+            }
+        }
+        return standingHandStates;
+    }
 
-    void gameStarts() {
-        blackjackPresenter.displayWelcomeMessage();
+public:
+    bool standsOnCurrentHand() {
+        static constexpr std::uint64_t standingHandStates = createStandingHandStates();
+        return (standingHandStates >> getCurrentHand().getHandState()) & 1;
     }
 
-    void gameEnds() {
-        blackjackPresenter.displayGoodbyeMessage();
+    // The dealer's first card, which is dealt face up.
+    Card getUpcard() {
+        return getCurrentHand().getCardAtPosition(0);
     }
+};
 
-    // Algorithm for a Blackjack round:
-    //     Place shuffled deck into dealing shoe
-    //     Player bets
-    //     Deal 2 cards to player
-    //     Display player's initial cards (i.e., 2 cards)
-    //     Deal 2 cards to dealer
-    //     Display dealer's first card
-    //     Hide dealer's second card (called the hole card)
-    //     Deal additional cards to player
-    //     If player busts
-    //         Player loses
-    //         Blackjack round is over
-    //     Display dealer's second card (namely, the hole card)
-    //     Deal additional cards to dealer
-    //     If dealer busts
-    //         Player wins
-    //         Blackjack round is over
-    //     If player's hand value is greater than dealer's hand value
-    //         Player wins
-    //         Blackjack round is over
-    //     If player's hand value is less than dealer's hand value
-    //         Player loses
-    //         Blackjack round is over
-    //     If player's hand value equals dealer's hand value
-    //         Player pushes
-    //         Blackjack round is over
-    //     Discard all cards (namely, player's hand, dealer's hand, and dealing shoe)
+// A table seats 1 to 7 players (see SeatArrays and BlackjackGame).
+struct SeatLimits {
+    static const int minimumNumberOfSeats = 1;
+    static const int maximumNumberOfSeats = 7;
+};
 
-    void roundStarts() {
-        blackjackPresenter.announceStartOfRound();
-        placeShuffledDeckIntoDealingShoe();
-        playerPlacesBet();
-        dealCardToPlayer(); // player's 1st card
-        dealCardToPlayer(); // player's 2nd card
-        displayPlayerHandContents();
-        dealCardToDealer(); // dealer's 1st card
-        displayDealerHandContents();
-        dealCardToDealer(); // dealer's 2nd card (namely, the hole card)
-        hideTheHoleCardFromPlayer(); // The hole card remains hidden.
-        dealAdditionalCardsToPlayer();
-        if (playerIsBusted()) {
-            playerLoses();
-            return;
+// The players of a table, stored as structure of arrays rather than as 1
+// object per player: the chips of every seat, and for every betting box its
+// bet, the state of its hand (see HandStates), its doubled and settled flags
+// and its cards lie in contiguous arrays. A player may split a pair up to 3
+// times, so each seat has up to 4 boxes (the house rules may allow fewer);
+// hand h of seat s is box s * maximumNumberOfHandsPerSeat + h. The bets still
+// in play at the showdown are settled by settleBets in 1 loop over the boxes.
+template <typename HouseRules = ClassicHouseRules>
+class SeatArrays {
+private:
+    static const int maximumNumberOfHandsPerSeat = 4;
+    static_assert(HouseRules::maximumNumberOfHands >= 1 && HouseRules::maximumNumberOfHands <= maximumNumberOfHandsPerSeat,
+                  "The house rules must allow 1 to 4 hands.");
+    static const int numberOfBoxes = SeatLimits::maximumNumberOfSeats * maximumNumberOfHandsPerSeat;
+    // A hand whose value is below 21 can take 1 more card, so even a run of
+    // aces cannot hold more than 21 cards.
+    static const int maximumNumberOfCardsInHand = 21;
+    static const int minimumBet = HouseRules::minimumBet;
+
+    int chipsToPlay[SeatLimits::maximumNumberOfSeats];
+    std::uint8_t numberOfHands[SeatLimits::maximumNumberOfSeats];
+    int chipsInBettingBox[numberOfBoxes];
+    int chipsReturnedAtShowdown[numberOfBoxes]; // -1 for a box settled before the showdown (see settleBets)
+    std::uint8_t handStates[numberOfBoxes];
+    std::uint8_t handIsDoubled[numberOfBoxes];
+    std::uint8_t handIsSettled[numberOfBoxes]; // e.g., a surrendered hand
+    std::uint8_t numberOfCardsInHand[numberOfBoxes];
+    Card cardsInHand[numberOfBoxes][maximumNumberOfCardsInHand];
+
+    static int getBoxIndex(int seatIndex, int handIndex) {
+        return seatIndex * maximumNumberOfHandsPerSeat + handIndex;
+    }
+
+    bool hasSplitPairs(int seatIndex) {
+        return numberOfHands[seatIndex] > 1;
+    }
+
+public:
+    SeatArrays() {
+        for (int seatIndex = 0; seatIndex < SeatLimits::maximumNumberOfSeats; seatIndex++) {
+            chipsToPlay[seatIndex] = 100; // Every player starts with 100 chips.
+            numberOfHands[seatIndex] = 1;
         }
-        displayDealerHandContents(); // Reveal the hole card.
-        dealAdditionalCardsToDealer();
-        if (dealerIsBusted()) {
-            playerWins();
-            return;
+        for (int boxIndex = 0; boxIndex < numberOfBoxes; boxIndex++) {
+            chipsInBettingBox[boxIndex] = 0;
+            chipsReturnedAtShowdown[boxIndex] = -1;
+            handStates[boxIndex] = HandStates::emptyHandState;
+            handIsDoubled[boxIndex] = 0;
+            handIsSettled[boxIndex] = 0;
+            numberOfCardsInHand[boxIndex] = 0;
         }
-        if (playerHandValueGreaterThanDealerHandValue()) {
-            playerWins();
-            return;
+    }
+
+    void buyChips(int seatIndex, int newChips) {
+        chipsToPlay[seatIndex] += newChips;
+    }
+
+    int getCurrentNumberOfChipsToPlay(int seatIndex) {
+        return chipsToPlay[seatIndex];
+    }
+
+    // A player can play as long as they can cover the minimum bet.
+    bool hasAvailableChipsToPlay(int seatIndex) {
+        if (chipsToPlay[seatIndex] >= minimumBet) {
+            return true;
+        } else {
+            return false;
         }
-        if (playerHandValueLessThanDealerHandValue()) {
-            playerLoses();
-            return;
+    }
+
+    // The initial bet goes into the 1st box of the seat.
+    void isBetting(int seatIndex, int chipsToBet) {
+        if (chipsToBet > chipsToPlay[seatIndex]) {
+            throw CustomExceptionWithErrorMessage("Error: player is trying to bet more than their available chips.");
         }
-        if (playerHandValueIsEqualToDealerHandValue()) {
-            playerPushes();
-            return;
+        if (chipsToBet < minimumBet) {
+            throw CustomExceptionWithErrorMessage("Error: player is trying to bet less than the minimum bet of " + std::to_string(minimumBet) + " chip(s).");
         }
+        chipsToPlay[seatIndex] -= chipsToBet;
+        chipsInBettingBox[getBoxIndex(seatIndex, 0)] += chipsToBet;
     }
 
-    void roundEnds() {
-        blackjackPresenter.announceEndOfRound();
-        discardAllCardsFromTable();
+    int getNumberOfHands(int seatIndex) {
+        return numberOfHands[seatIndex];
     }
 
-    void placeShuffledDeckIntoDealingShoe() {
-        clearDeck();
-        getOrderedDeck();
-        shuffleDeck();
+    int getBetInChips(int seatIndex, int handIndex) {
+        return chipsInBettingBox[getBoxIndex(seatIndex, handIndex)];
     }
 
-    void clearDeck() {
-        deck.clearDeck();
+    void addCardToHand(int seatIndex, int handIndex, Card newCard) {
+        int boxIndex = getBoxIndex(seatIndex, handIndex);
+        if (numberOfCardsInHand[boxIndex] == maximumNumberOfCardsInHand) {
+            throw CustomExceptionWithErrorMessage("Error: cannot add card to a full hand.");
+        }
+        cardsInHand[boxIndex][numberOfCardsInHand[boxIndex]] = newCard;
+        numberOfCardsInHand[boxIndex]++;
+        handStates[boxIndex] = HandStates::addCard(handStates[boxIndex], newCard);
     }
 
-    // Ordered deck needs to be shuffled before use.
-    void getOrderedDeck() {
-        deck.createOrderedDeck();
+    int getNumberOfCardsInHand(int seatIndex, int handIndex) {
+        return numberOfCardsInHand[getBoxIndex(seatIndex, handIndex)];
     }
 
-    void shuffleDeck() {
-        deck.shuffleDeck();
+    Card getCardAtPosition(int seatIndex, int handIndex, int cardIndex) {
+        return cardsInHand[getBoxIndex(seatIndex, handIndex)][cardIndex];
     }
 
-    bool isDeckEmpty() {
-        return deck.isDeckEmpty();
+    void appendHandInTextFormat(int seatIndex, int handIndex, std::string& textBuffer) {
+        int boxIndex = getBoxIndex(seatIndex, handIndex);
+        for (int cardIndex = 0; cardIndex < numberOfCardsInHand[boxIndex]; cardIndex++) {
+            cardsInHand[boxIndex][cardIndex].appendCardInTextFormat(textBuffer);
+            textBuffer += " | ";
+        }
     }
 
-    void playerPlacesBet() {
-        int playerCurrentNumberOfChipsToPlay = getPlayerCurrentNumberOfChipsToPlay();
-        blackjackPresenter.displayPlayerAvailableChipsToBetWith(playerCurrentNumberOfChipsToPlay);
-        int minimumBet = 1; // The player must bet at least 1 chip.
-        int maximumBet = playerCurrentNumberOfChipsToPlay; // There is no limit to maximum bet.
-        int playerBetInChips = blackjackPresenter.askPlayerToBetChips(minimumBet, maximumBet);
-        player.isBetting(playerBetInChips);
+    int getHandValue(int seatIndex, int handIndex) {
+        return HandStates::getHandValue(handStates[getBoxIndex(seatIndex, handIndex)]);
     }
 
-    bool playerHasAvailableChipsToPlay() {
-        return player.hasAvailableChipsToPlay();
+    // A soft hand counts 1 ace as 11.
+    bool isSoftHand(int seatIndex, int handIndex) {
+        return HandStates::isSoftHand(handStates[getBoxIndex(seatIndex, handIndex)]);
     }
 
-    int getPlayerCurrentNumberOfChipsToPlay() {
-        return player.getCurrentNumberOfChipsToPlay();
+    bool isBusted(int seatIndex, int handIndex) {
+        return HandStates::isBusted(handStates[getBoxIndex(seatIndex, handIndex)]);
     }
 
-    void informPlayerAboutLackOfChips() {
-        blackjackPresenter.displayRegretMessageNoChips();
+    // A natural is a 21 on the first 2 cards (a split hand is never 1).
+    bool hasNaturalBlackjack(int seatIndex, int handIndex) {
+        if (!hasSplitPairs(seatIndex) && getNumberOfCardsInHand(seatIndex, handIndex) == 2 && getHandValue(seatIndex, handIndex) == 21) {
+            return true;
+        } else {
+            return false;
+        }
     }
 
-    void displayPlayerHandContents() {
-        std::string playerHandInTextFormat = player.getHandInTextFormat();
-        blackjackPresenter.displayPlayerHand(playerHandInTextFormat);
-        int playerHandValue = player.getHandValue();
-        blackjackPresenter.displayPlayerHandValue(playerHandValue);
+    bool isHandSettled(int seatIndex, int handIndex) {
+        return handIsSettled[getBoxIndex(seatIndex, handIndex)] != 0;
     }
 
-    int getPlayerHandValue() {
-        return player.getHandValue();
+    bool isHandDoubled(int seatIndex, int handIndex) {
+        return handIsDoubled[getBoxIndex(seatIndex, handIndex)] != 0;
     }
 
-    void hideTheHoleCardFromPlayer() {
-        blackjackPresenter.announceSecondCardOfDealerIsHidden(); // The hole card is kept hidden for now.
+    // The player may double their bet on any 2-card hand (also after a split,
+    // unless the house rules say otherwise) and then takes exactly 1 more card.
+    bool canDoubleDown(int seatIndex, int handIndex) {
+        if constexpr (!HouseRules::doublingDownIsAllowed) {
+            return false;
+        }
+        if constexpr (!HouseRules::doublingDownAfterSplitIsAllowed) {
+            if (hasSplitPairs(seatIndex)) {
+                return false;
+            }
+        }
+        if (getNumberOfCardsInHand(seatIndex, handIndex) == 2 && chipsToPlay[seatIndex] >= getBetInChips(seatIndex, handIndex)) {
+            return true;
+        } else {
+            return false;
+        }
     }
 
-    void dealCardToPlayer() {
-        if (isDeckEmpty()) {
-            placeShuffledDeckIntoDealingShoe();
+    void isDoublingDown(int seatIndex, int handIndex) {
+        if (!canDoubleDown(seatIndex, handIndex)) {
+            throw CustomExceptionWithErrorMessage("Error: player is not allowed to double down.");
         }
-        Card* playerCard = deck.drawCardfromDeck();
-        player.isHitting(playerCard);
+        int boxIndex = getBoxIndex(seatIndex, handIndex);
+        chipsToPlay[seatIndex] -= chipsInBettingBox[boxIndex];
+        chipsInBettingBox[boxIndex] *= 2;
+        handIsDoubled[boxIndex] = 1;
     }
 
-    void dealAdditionalCardsToPlayer() {
-        while (!playerIsBusted() && !playerHasBlackjack()) {
-            bool playerWantsOneMoreCard = checkPlayerWantsOneMoreCard();
-            if (!playerWantsOneMoreCard) {
-                return;
-            } else {
-                dealCardToPlayer();
-                displayPlayerHandContents();
-            }
+    // A pair is 2 cards of the same value (e.g., a jack and a king). Split
+    // aces cannot be split again.
+    bool canSplit(int seatIndex, int handIndex) {
+        if constexpr (HouseRules::maximumNumberOfHands == 1) {
+            return false;
+        }
+        if (getNumberOfCardsInHand(seatIndex, handIndex) != 2 || numberOfHands[seatIndex] == HouseRules::maximumNumberOfHands ||
+            chipsToPlay[seatIndex] < getBetInChips(seatIndex, handIndex)) {
+            return false;
+        }
+        if (getCardAtPosition(seatIndex, handIndex, 0).getCardValue() != getCardAtPosition(seatIndex, handIndex, 1).getCardValue()) {
+            return false;
+        }
+        if (isHandFromSplitAces(seatIndex, handIndex)) {
+            return false;
         }
+        return true;
     }
 
-    bool checkPlayerWantsOneMoreCard() {
-        return blackjackPresenter.askPlayerForAdditionalCard();
+    // The 2nd card of the pair starts a new hand with an equal bet; each hand
+    // then receives its 2nd card when it is played.
+    void isSplitting(int seatIndex, int handIndex) {
+        if (!canSplit(seatIndex, handIndex)) {
+            throw CustomExceptionWithErrorMessage("Error: player is not allowed to split.");
+        }
+        int boxIndex = getBoxIndex(seatIndex, handIndex);
+        Card firstCardOfPair = cardsInHand[boxIndex][0];
+        Card secondCardOfPair = cardsInHand[boxIndex][1];
+        numberOfCardsInHand[boxIndex] = 1;
+        handStates[boxIndex] = HandStates::addCard(HandStates::emptyHandState, firstCardOfPair);
+        int indexOfNewBox = getBoxIndex(seatIndex, numberOfHands[seatIndex]);
+        numberOfHands[seatIndex]++;
+        cardsInHand[indexOfNewBox][0] = secondCardOfPair;
+        numberOfCardsInHand[indexOfNewBox] = 1;
+        handStates[indexOfNewBox] = HandStates::addCard(HandStates::emptyHandState, secondCardOfPair);
+        chipsToPlay[seatIndex] -= chipsInBettingBox[boxIndex];
+        chipsInBettingBox[indexOfNewBox] = chipsInBettingBox[boxIndex];
     }
 
-    bool playerIsBusted() {
-        return player.isBusted();
+    // Split aces receive only 1 more card each.
+    bool isHandFromSplitAces(int seatIndex, int handIndex) {
+        return hasSplitPairs(seatIndex) && getCardAtPosition(seatIndex, handIndex, 0).isAce();
     }
 
-    bool playerHasBlackjack() {
-        return player.hasBlackjack();
+    // Surrender of the initial 2-card hand: half the bet is returned, so
+    // the bet must be an even number of chips.
+    bool canSurrender(int seatIndex, int handIndex) {
+        if constexpr (!HouseRules::surrenderIsAllowed) {
+            return false;
+        }
+        if (!hasSplitPairs(seatIndex) && getNumberOfCardsInHand(seatIndex, handIndex) == 2 && getBetInChips(seatIndex, handIndex) % 2 == 0 &&
+            !isHandSettled(seatIndex, handIndex)) {
+            return true;
+        } else {
+            return false;
+        }
     }
 
-    void playerWins() {
-        player.wins();
-        blackjackPresenter.announcePlayerWins();
-        informPlayerAboutTheirCurrentNumberOfChips();
+    void surrenders(int seatIndex, int handIndex) {
+        if (!canSurrender(seatIndex, handIndex)) {
+            throw CustomExceptionWithErrorMessage("Error: player is not allowed to surrender.");
+        }
+        int boxIndex = getBoxIndex(seatIndex, handIndex);
+        chipsToPlay[seatIndex] += chipsInBettingBox[boxIndex] / 2;
+        handIsSettled[boxIndex] = 1;
     }
 
-    void playerPushes() {
-        player.pushes();
-        blackjackPresenter.announcePlayerPushes();
-        informPlayerAboutTheirCurrentNumberOfChips();
+    // The bet is lost at once (e.g., the hand is busted).
+    void loses(int seatIndex, int handIndex) {
+        handIsSettled[getBoxIndex(seatIndex, handIndex)] = 1; // Bet is lost (i.e., taken by the dealer).
     }
 
-    void playerLoses() {
-        player.loses();
-        blackjackPresenter.announcePlayerLoses();
-        informPlayerAboutTheirCurrentNumberOfChips();
+    // Settles every box still in play against the dealer's final hand. A
+    // natural pays 3:2 if the house rules say so (half chips are not paid, so
+    // an odd bet is rounded down), and then beats any other 21 and loses to
+    // a dealer's natural. Otherwise a busted dealer loses, the higher hand
+    // value wins (paid out at 1:1) and equal hand values push. The chips
+    // returned to the player (bet included) are kept per box.
+    void settleBets(int numberOfSeats, int dealerHandValue, bool dealerHasNatural) {
+        bool dealerIsBusted = dealerHandValue > 21;
+        for (int seatIndex = 0; seatIndex < numberOfSeats; seatIndex++) {
+            bool seatHasNaturalHand = numberOfHands[seatIndex] == 1;
+            for (int boxIndex = getBoxIndex(seatIndex, 0); boxIndex < getBoxIndex(seatIndex, numberOfHands[seatIndex]); boxIndex++) {
+                if (handIsSettled[boxIndex]) {
+                    continue;
+                }
+                int playerHandValue = HandStates::getHandValue(handStates[boxIndex]);
+                int betInChips = chipsInBettingBox[boxIndex];
+                bool playerWins = dealerIsBusted || playerHandValue > dealerHandValue;
+                bool playerPushes = !dealerIsBusted && playerHandValue == dealerHandValue;
+                // win: bet returned and 1:1 payout; push: bet returned; loss: nothing
+                int chipsReturned = betInChips * (2 * playerWins + playerPushes);
+                if constexpr (HouseRules::blackjackPaysThreeToTwo) {
+                    bool playerHasNatural = seatHasNaturalHand && numberOfCardsInHand[boxIndex] == 2 && playerHandValue == 21;
+                    if (playerHasNatural && !dealerHasNatural) {
+                        chipsReturned = betInChips + betInChips * 3 / 2;
+                    } else if (!playerHasNatural && dealerHasNatural) {
+                        chipsReturned = 0;
+                    }
+                }
+                chipsToPlay[seatIndex] += chipsReturned;
+                chipsReturnedAtShowdown[boxIndex] = chipsReturned;
+                handIsSettled[boxIndex] = 1;
+            }
+        }
     }
 
-    void informPlayerAboutTheirCurrentNumberOfChips() {
-        int playerCurrentNumberOfChipsToPlay = getPlayerCurrentNumberOfChipsToPlay();
-        blackjackPresenter.displayPlayerCurrentNumberOfChips(playerCurrentNumberOfChipsToPlay);
+    // -1 if the hand was settled before the showdown (see settleBets).
+    int getChipsReturnedAtShowdown(int seatIndex, int handIndex) {
+        return chipsReturnedAtShowdown[getBoxIndex(seatIndex, handIndex)];
     }
 
-    bool askPlayerToPlayNewRound() {
-        return blackjackPresenter.askPlayerToPlayNewRound();
+    // The cards and bets of every seat are discarded, leaving 1 empty hand
+    // per seat.
+    void clearHands(int numberOfSeats) {
+        for (int seatIndex = 0; seatIndex < numberOfSeats; seatIndex++) {
+            for (int boxIndex = getBoxIndex(seatIndex, 0); boxIndex < getBoxIndex(seatIndex, numberOfHands[seatIndex]); boxIndex++) {
+                chipsInBettingBox[boxIndex] = 0;
+                chipsReturnedAtShowdown[boxIndex] = -1;
+                handStates[boxIndex] = HandStates::emptyHandState;
+                handIsDoubled[boxIndex] = 0;
+                handIsSettled[boxIndex] = 0;
+                numberOfCardsInHand[boxIndex] = 0;
+            }
+            numberOfHands[seatIndex] = 1;
+        }
     }
+};
 
-    void displayDealerHandContents() {
-        std::string dealerHandInTextFormat = dealer.getHandInTextFormat();
-        blackjackPresenter.displayDealerHand(dealerHandInTextFormat);
-        int dealerHandValue = dealer.getHandValue();
-        blackjackPresenter.displayDealerHandValue(dealerHandValue);
-    }
+// Hands of many independent tables evaluated at once (see EventLoopSimulation,
+// which evaluates the hands of all of its tables in lockstep). The hands are
+// stored as structure of arrays (hard hand values and ace flags in contiguous
+// byte arrays), and evaluateHands computes the hand value, softness, bust and
+// dealer-stand flag of every hand with the rules of Hand::computeHandValue
+// and Dealer::standsOnHand.
+// The evaluation uses AVX2 (32 hands per instruction) when the program is
+// built for a CPU supporting it (e.g., with -mavx2 or -march=native), and a
+// scalar loop otherwise.
+template <typename HouseRules = ClassicHouseRules>
+class HandBatch {
+private:
+    static const int numberOfHandsPerVector = 32;
+    int numberOfHands;
+    // Arrays are padded to whole vectors; the padding hands are never read.
+    std::vector<std::uint8_t> hardHandValues;
+    std::vector<std::uint8_t> aceFlags;
+    std::vector<std::uint8_t> handValues;
+    std::vector<std::uint8_t> softHandFlags;
+    std::vector<std::uint8_t> bustFlags;
+    std::vector<std::uint8_t> dealerStandsFlags;
 
-    int getDealerHandValue() {
-        return dealer.getHandValue();
+    // The arrays are passed as restrict pointers: byte stores may otherwise
+    // alias anything, which keeps the compiler from vectorizing the loop.
+    static void evaluateHandsWithScalarLoop(const std::uint8_t* __restrict hardHandValue, const std::uint8_t* __restrict aceExists,
+                                            std::uint8_t* __restrict handValue, std::uint8_t* __restrict softHand,
+                                            std::uint8_t* __restrict busted, std::uint8_t* __restrict dealerStands,
+                                            int numberOfHandsToEvaluate) {
+        for (int handIndex = 0; handIndex < numberOfHandsToEvaluate; handIndex++) {
+            std::uint8_t currentHandIsSoft = (aceExists[handIndex] != 0) & (hardHandValue[handIndex] <= 11);
+            std::uint8_t currentHandValue = hardHandValue[handIndex] + 10 * currentHandIsSoft; // 1 ace counts as 11
+            handValue[handIndex] = currentHandValue;
+            softHand[handIndex] = currentHandIsSoft;
+            busted[handIndex] = currentHandValue > 21;
+            dealerStands[handIndex] = Dealer<HouseRules>::standsOnHand(currentHandValue, currentHandIsSoft);
+        }
     }
 
-    void dealCardToDealer() {
-        if (isDeckEmpty()) {
-            placeShuffledDeckIntoDealingShoe();
+#if defined(__AVX2__)
+    void evaluateHandsWithAvx2() {
+        // Hand values stay far below 128, so signed byte comparisons are exact.
+        const __m256i twelve = _mm256_set1_epi8(12);
+        const __m256i ten = _mm256_set1_epi8(10);
+        const __m256i twentyOne = _mm256_set1_epi8(21);
+        const __m256i sixteen = _mm256_set1_epi8(16);
+        const __m256i seventeen = _mm256_set1_epi8(17);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi8(1);
+        for (int handIndex = 0; handIndex < numberOfHands; handIndex += numberOfHandsPerVector) {
+            __m256i hardHandValue = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&hardHandValues[handIndex]));
+            __m256i aceExists = _mm256_cmpgt_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&aceFlags[handIndex])), zero);
+            __m256i softHand = _mm256_and_si256(aceExists, _mm256_cmpgt_epi8(twelve, hardHandValue));
+            __m256i handValue = _mm256_add_epi8(hardHandValue, _mm256_and_si256(softHand, ten)); // 1 ace counts as 11
+            __m256i busted = _mm256_cmpgt_epi8(handValue, twentyOne);
+            __m256i dealerStands = _mm256_cmpgt_epi8(handValue, sixteen); // at least 17
+            if constexpr (HouseRules::dealerHitsSoft17) {
+                __m256i softSeventeen = _mm256_and_si256(softHand, _mm256_cmpeq_epi8(handValue, seventeen));
+                dealerStands = _mm256_andnot_si256(softSeventeen, dealerStands);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&handValues[handIndex]), handValue);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&softHandFlags[handIndex]), _mm256_and_si256(softHand, one));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&bustFlags[handIndex]), _mm256_and_si256(busted, one));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dealerStandsFlags[handIndex]), _mm256_and_si256(dealerStands, one));
         }
-        Card* dealerCard = deck.drawCardfromDeck();
-        dealer.isHitting(dealerCard);
     }
+#endif
 
-    void dealAdditionalCardsToDealer() {
-        while (!dealerHandValueIsAtLeast17()) {
-            dealCardToDealer();
-            displayDealerHandContents();
+public:
+    HandBatch(int hands) {
+        if (hands < 1) {
+            throw CustomExceptionWithErrorMessage("Error: a hand batch needs at least 1 hand.");
         }
+        numberOfHands = hands;
+        int paddedNumberOfHands = (hands + numberOfHandsPerVector - 1) / numberOfHandsPerVector * numberOfHandsPerVector;
+        hardHandValues.assign(paddedNumberOfHands, 0);
+        aceFlags.assign(paddedNumberOfHands, 0);
+        handValues.assign(paddedNumberOfHands, 0);
+        softHandFlags.assign(paddedNumberOfHands, 0);
+        bustFlags.assign(paddedNumberOfHands, 0);
+        dealerStandsFlags.assign(paddedNumberOfHands, 0);
     }
 
-    bool dealerHandValueIsAtLeast17() {
-        return dealer.handValueIsAtLeast17();
+    int getNumberOfHands() {
+        return numberOfHands;
     }
 
-    bool dealerIsBusted() {
-        return dealer.isBusted();
+    // The cards in every hand are discarded.
+    void clearHands() {
+        std::fill(hardHandValues.begin(), hardHandValues.end(), 0);
+        std::fill(aceFlags.begin(), aceFlags.end(), 0);
     }
 
-    bool playerHandValueGreaterThanDealerHandValue() {
-        int playerHandValue = getPlayerHandValue();
-        int dealerHandValue = getDealerHandValue();
-        if (playerHandValue > dealerHandValue) {
-            return true;
-        } else {
-            return false;
-        }
+    // The cards of 1 hand are discarded.
+    void clearHand(int handIndex) {
+        hardHandValues[handIndex] = 0;
+        aceFlags[handIndex] = 0;
     }
 
-    bool playerHandValueIsEqualToDealerHandValue() {
-        int playerHandValue = getPlayerHandValue();
-        int dealerHandValue = getDealerHandValue();
-        if (playerHandValue == dealerHandValue) {
-            return true;
-        } else {
-            return false;
-        }
+    void addCardToHand(int handIndex, Card newCard) {
+        hardHandValues[handIndex] += newCard.getCardValue();
+        aceFlags[handIndex] |= newCard.isAce();
     }
 
-    bool playerHandValueLessThanDealerHandValue() {
-        int playerHandValue = getPlayerHandValue();
-        int dealerHandValue = getDealerHandValue();
-        if (playerHandValue < dealerHandValue) {
-            return true;
-        } else {
-            return false;
+    // Deals 1 card to every hand in lockstep; cardValues holds 1 card value
+    // (ace = 1) per hand.
+    void addCardValuesToHands(const std::uint8_t* cardValues) {
+        for (int handIndex = 0; handIndex < numberOfHands; handIndex++) {
+            hardHandValues[handIndex] += cardValues[handIndex];
+            aceFlags[handIndex] |= (cardValues[handIndex] == 1);
         }
     }
 
-    // Discard player's hand, dealer's hand, and remaining cards in deck.
-    void discardAllCardsFromTable() {
-        player.clearHand();
-        dealer.clearHand();
-        deck.clearDeck();
+    void evaluateHands() {
+#if defined(__AVX2__)
+        evaluateHandsWithAvx2();
+#else
+        evaluateHandsWithScalarLoop(hardHandValues.data(), aceFlags.data(), handValues.data(), softHandFlags.data(),
+                                    bustFlags.data(), dealerStandsFlags.data(), numberOfHands);
+#endif
     }
 
-public:
-    void beginPlaying() {
-        // A Blackjack game consists of 1 or more rounds.
-        gameStarts();
-        if (!playerHasAvailableChipsToPlay()) {
-            informPlayerAboutLackOfChips();
-            gameEnds();
-            return;
-        }
-        do {
+    // Results of the last evaluateHands call.
+    int getHandValue(int handIndex) {
+        return handValues[handIndex];
+    }
+
+    bool isSoftHand(int handIndex) {
+        return softHandFlags[handIndex] != 0;
+    }
+
+    bool isBusted(int handIndex) {
+        return bustFlags[handIndex] != 0;
+    }
+
+    bool dealerStands(int handIndex) {
+        return dealerStandsFlags[handIndex] != 0;
+    }
+};
+
+// SplitMix64 step: turns any 64-bit seed (even 0 or consecutive seeds) into
+// well mixed generator state.
+std::uint64_t nextSplitMix64(std::uint64_t& splitMixState) {
+    splitMixState += 0x9E3779B97F4A7C15ULL;
+    std::uint64_t mixedBits = splitMixState;
+    mixedBits = (mixedBits ^ (mixedBits >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    mixedBits = (mixedBits ^ (mixedBits >> 27)) * 0x94D049BB133111EBULL;
+    return mixedBits ^ (mixedBits >> 31);
+}
+
+// Random number generators that can be plugged into Deck::shuffleDeck.
+// A generator provides:
+//     std::uint64_t operator()()          next 64 random bits
+//     void seed(std::uint64_t seed)       restart the generator from a seed
+// Independent streams (e.g., 1 per simulation chunk) are obtained by seeding
+// each stream with a different seed.
+
+// xoshiro256** (Blackman and Vigna): the default generator, a few cycles per
+// number with 256 bits of state.
+class Xoshiro256StarStarGenerator {
+private:
+    std::uint64_t generatorState[4];
+
+    static std::uint64_t rotateLeft(std::uint64_t bits, int shift) {
+        return (bits << shift) | (bits >> (64 - shift));
+    }
+
+public:
+    typedef std::uint64_t result_type;
+
+    Xoshiro256StarStarGenerator() {
+        seed(0);
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return ~static_cast<result_type>(0);
+    }
+
+    void seed(std::uint64_t seed) {
+        std::uint64_t splitMixState = seed;
+        for (int stateIndex = 0; stateIndex < 4; stateIndex++) {
+            generatorState[stateIndex] = nextSplitMix64(splitMixState);
+        }
+    }
+
+    result_type operator()() {
+        std::uint64_t randomBits = rotateLeft(generatorState[1] * 5, 7) * 9;
+        std::uint64_t shiftedState = generatorState[1] << 17;
+        generatorState[2] ^= generatorState[0];
+        generatorState[3] ^= generatorState[1];
+        generatorState[1] ^= generatorState[2];
+        generatorState[0] ^= generatorState[3];
+        generatorState[2] ^= shiftedState;
+        generatorState[3] = rotateLeft(generatorState[3], 45);
+        return randomBits;
+    }
+};
+
+// std::mt19937_64, kept for compatibility with existing analyses.
+class Mt19937_64Generator {
+private:
+    std::mt19937_64 mersenneTwisterEngine;
+
+public:
+    typedef std::uint64_t result_type;
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return ~static_cast<result_type>(0);
+    }
+
+    void seed(std::uint64_t seed) {
+        mersenneTwisterEngine.seed(seed);
+    }
+
+    result_type operator()() {
+        return mersenneTwisterEngine();
+    }
+};
+
+// The dealing shoe: 1 to 8 standard 52-card decks kept in 1 contiguous
+// buffer. Cards are drawn by advancing an index, so drawn cards stay in the
+// buffer and the whole shoe can be reshuffled without rebuilding it.
+// A cut card is placed after the given penetration (fraction of the shoe
+// dealt); once it is reached, the shoe should be reshuffled before the next
+// round. A penetration of 0 means the shoe is reshuffled before every round.
+// The number of cards left of each rank and the Hi-Lo running count of the
+// cards drawn are updated on every draw, so that the composition of the shoe
+// and the true count can be queried in O(1) (e.g., by composition-dependent
+// strategies).
+class Deck {
+private:
+    std::vector<Card> cardsInDeck; // capacity is reserved once, so rebuilding the deck never allocates
+    int indexOfNextCardToDraw;
+    int numberOfDecksInShoe;
+    int cutCardPosition;
+    int numberOfCardsOfRankLeft[King + 1];
+    int runningCount;
+    static const int totalNumberOfCardsInCompleteDeck = 52;
+
+    // Hi-Lo count of a drawn card, per rank: +1 for 2 to 6, 0 for 7 to 9 and
+    // -1 for aces and ten-valued cards.
+    static constexpr int hiLoCountOfCardRank[King + 1] = {-1, 1, 1, 1, 1, 1, 0, 0, 0, -1, -1, -1, -1};
+
+    // Every card of the shoe is left and none has been counted.
+    void resetShoeComposition() {
+        for (int rankInIntegerFormat = Ace; rankInIntegerFormat <= King; rankInIntegerFormat++) {
+            numberOfCardsOfRankLeft[rankInIntegerFormat] = 4 * numberOfDecksInShoe;
+        }
+        runningCount = 0;
+    }
+
+    void createOrderedCardsOfSuit(CardSuit suit) {
+        for (int rankInIntegerFormat = Ace; rankInIntegerFormat <= King; rankInIntegerFormat++) {
+            CardRank rank = static_cast<CardRank>(rankInIntegerFormat);
+            cardsInDeck.push_back(Card(rank, suit));
+        }
+    }
+
+public:
+    static const int minimumNumberOfDecksInShoe = 1;
+    static const int maximumNumberOfDecksInShoe = 8;
+
+    Deck() : Deck(1, 0.0) {
+    }
+
+    Deck(int numberOfDecks, double penetration) {
+        if (numberOfDecks < minimumNumberOfDecksInShoe || numberOfDecks > maximumNumberOfDecksInShoe) {
+            throw CustomExceptionWithErrorMessage("Error: the dealing shoe must contain between 1 and 8 decks.");
+        }
+        if (!(penetration >= 0.0 && penetration <= 1.0)) {
+            throw CustomExceptionWithErrorMessage("Error: the penetration of the dealing shoe must be between 0 and 1.");
+        }
+        numberOfDecksInShoe = numberOfDecks;
+        cutCardPosition = static_cast<int>(penetration * numberOfDecks * totalNumberOfCardsInCompleteDeck + 0.5);
+        cardsInDeck.reserve(numberOfDecks * totalNumberOfCardsInCompleteDeck);
+        createOrderedDeck();
+    }
+
+    // Discard cards (if any) in deck and create an ordered deck of cards.
+    void createOrderedDeck() {
+        cardsInDeck.clear();
+        for (int deckNumber = 0; deckNumber < numberOfDecksInShoe; deckNumber++) {
+            createOrderedCardsOfSuit(Spades);
+            createOrderedCardsOfSuit(Hearts);
+            createOrderedCardsOfSuit(Diamonds);
+            createOrderedCardsOfSuit(Clubs);
+        }
+        indexOfNextCardToDraw = 0;
+        resetShoeComposition();
+    }
+
+    // The deck of cards is discarded (the running count is kept).
+    void clearDeck() {
+        indexOfNextCardToDraw = cardsInDeck.size();
+        for (int rankInIntegerFormat = Ace; rankInIntegerFormat <= King; rankInIntegerFormat++) {
+            numberOfCardsOfRankLeft[rankInIntegerFormat] = 0;
+        }
+    }
+
+    bool isDeckEmpty() {
+        return indexOfNextCardToDraw == static_cast<int>(cardsInDeck.size());
+    }
+
+    int getCurrentNumberOfCardsInDeck() {
+        return cardsInDeck.size() - indexOfNextCardToDraw;
+    }
+
+    int getPositionOfNextCardToDraw() {
+        return indexOfNextCardToDraw;
+    }
+
+    int getNumberOfDecksInShoe() {
+        return numberOfDecksInShoe;
+    }
+
+    // Number of cards of each value (ace = 1, ten/face = 10) left in the deck.
+    void getNumberOfCardsOfEachValue(int numberOfCardsOfValue[11]) {
+        for (int cardValue = 0; cardValue <= 10; cardValue++) {
+            numberOfCardsOfValue[cardValue] = getNumberOfCardsOfValueLeft(cardValue);
+        }
+    }
+
+    int getNumberOfCardsOfRankLeft(CardRank rank) {
+        return numberOfCardsOfRankLeft[rank];
+    }
+
+    // cardValue is 1 (ace) to 10 (ten/face); other values have no cards.
+    int getNumberOfCardsOfValueLeft(int cardValue) {
+        if (cardValue == 10) {
+            return numberOfCardsOfRankLeft[Ten] + numberOfCardsOfRankLeft[Jack] + numberOfCardsOfRankLeft[Queen] + numberOfCardsOfRankLeft[King];
+        } else if (cardValue >= 1 && cardValue <= 9) {
+            return numberOfCardsOfRankLeft[cardValue - 1]; // Ace is rank 0, Two is rank 1, ...
+        } else {
+            return 0;
+        }
+    }
+
+    // Hi-Lo count of the cards drawn since the shoe was last reshuffled.
+    int getRunningCount() {
+        return runningCount;
+    }
+
+    double getNumberOfDecksLeft() {
+        return static_cast<double>(getCurrentNumberOfCardsInDeck()) / totalNumberOfCardsInCompleteDeck;
+    }
+
+    // Running count per deck left in the shoe (0 once the shoe is empty).
+    double getTrueCount() {
+        int currentNumberOfCardsInDeck = getCurrentNumberOfCardsInDeck();
+        if (currentNumberOfCardsInDeck == 0) {
+            return 0.0;
+        }
+        return runningCount * static_cast<double>(totalNumberOfCardsInCompleteDeck) / currentNumberOfCardsInDeck;
+    }
+
+    bool isCutCardReached() {
+        return indexOfNextCardToDraw >= cutCardPosition;
+    }
+
+    // Random number from 0 to numberOfCandidates - 1, drawn with Lemire's
+    // multiply-shift method, so a given seed gives the same shuffle with any
+    // compiler or standard library. The products whose low 64 bits fall below
+    // 2^64 mod numberOfCandidates are rejected, so every number is equally
+    // likely (a draw is rejected with a probability below 2^-55, even for an
+    // 8-deck shoe).
+    template <typename RandomNumberGenerator>
+    static std::uint64_t drawRandomNumberBelow(std::uint64_t numberOfCandidates, RandomNumberGenerator& randomNumberGenerator) {
+        unsigned __int128 product = static_cast<unsigned __int128>(randomNumberGenerator()) * numberOfCandidates;
+        std::uint64_t lowBits = static_cast<std::uint64_t>(product);
+        if (lowBits < numberOfCandidates) {
+            std::uint64_t rejectionThreshold = (0 - numberOfCandidates) % numberOfCandidates; // 2^64 mod numberOfCandidates
+            while (lowBits < rejectionThreshold) {
+                product = static_cast<unsigned __int128>(randomNumberGenerator()) * numberOfCandidates;
+                lowBits = static_cast<std::uint64_t>(product);
+            }
+        }
+        return static_cast<std::uint64_t>(product >> 64);
+    }
+
+    // Fisher-Yates shuffle of the cards left in the deck with a caller-owned
+    // random number generator.
+    template <typename RandomNumberGenerator>
+    void shuffleDeck(RandomNumberGenerator& randomNumberGenerator) {
+        for (int deckIndex = cardsInDeck.size() - 1; deckIndex > indexOfNextCardToDraw; deckIndex--) {
+            std::uint64_t numberOfCandidates = deckIndex - indexOfNextCardToDraw + 1;
+            int randomIndex = indexOfNextCardToDraw + static_cast<int>(drawRandomNumberBelow(numberOfCandidates, randomNumberGenerator));
+            std::swap(cardsInDeck[deckIndex], cardsInDeck[randomIndex]);
+        }
+    }
+
+    // All cards (dealt or not) are put back into the shoe and shuffled.
+    template <typename RandomNumberGenerator>
+    void reshuffleShoe(RandomNumberGenerator& randomNumberGenerator) {
+        BLACKJACK_INSTRUMENT_RESHUFFLE();
+        indexOfNextCardToDraw = 0;
+        resetShoeComposition();
+        shuffleDeck(randomNumberGenerator);
+    }
+
+    Card drawCardfromDeck() {
+        if (isDeckEmpty()) {
+            throw CustomExceptionWithErrorMessage("Error: cannot draw card from an empty deck.");
+        } else {
+            BLACKJACK_INSTRUMENT_CARD_DRAWN();
+            Card removedCard = cardsInDeck[indexOfNextCardToDraw];
+            indexOfNextCardToDraw++;
+            CardRank removedCardRank = removedCard.getCardRank();
+            numberOfCardsOfRankLeft[removedCardRank]--;
+            runningCount += hiLoCountOfCardRank[removedCardRank];
+            return removedCard;
+        }
+    }
+
+    void displayCardsInDeckInTextFormat() {
+        int currentNumberOfCardsInDeck = getCurrentNumberOfCardsInDeck();
+        std::string trailingCharacterS = ""; // singular number ("s" character is not appended)
+        if (currentNumberOfCardsInDeck > 1) {
+            trailingCharacterS = "s"; // plural number ("s" character is appended)
+        }
+        std::cout << "The deck contains " << currentNumberOfCardsInDeck << " card" << trailingCharacterS << "." << std::endl;
+        if (isDeckEmpty()) {
+            return;
+        } else {
+            for (int deckIndex = indexOfNextCardToDraw; deckIndex < static_cast<int>(cardsInDeck.size()); deckIndex++) {
+                std::cout << cardsInDeck[deckIndex].getCardInTextFormat() << std::endl;
+            }
+        }
+    }
+};
+
+// Cards left in the dealing shoe, counted by card value (ace = 1, ten and
+// face cards = 10; index 0 is unused).
+struct ShoeComposition {
+    int numberOfCardsOfValue[11];
+    int totalNumberOfCards;
+
+    ShoeComposition() {
+        for (int cardValue = 0; cardValue <= 10; cardValue++) {
+            numberOfCardsOfValue[cardValue] = 0;
+        }
+        totalNumberOfCards = 0;
+    }
+
+    static ShoeComposition createFullShoe(int numberOfDecks) {
+        ShoeComposition composition;
+        for (int cardValue = 1; cardValue <= 9; cardValue++) {
+            composition.numberOfCardsOfValue[cardValue] = 4 * numberOfDecks;
+        }
+        composition.numberOfCardsOfValue[10] = 16 * numberOfDecks; // 10, Jack, Queen, King
+        composition.totalNumberOfCards = 52 * numberOfDecks;
+        return composition;
+    }
+
+    static ShoeComposition createFromDeck(Deck& deck) {
+        ShoeComposition composition;
+        deck.getNumberOfCardsOfEachValue(composition.numberOfCardsOfValue);
+        composition.totalNumberOfCards = deck.getCurrentNumberOfCardsInDeck();
+        return composition;
+    }
+
+    void removeCardOfValue(int cardValue) {
+        if (numberOfCardsOfValue[cardValue] == 0) {
+            throw CustomExceptionWithErrorMessage("Error: the shoe has no card of the requested value left.");
+        }
+        numberOfCardsOfValue[cardValue]--;
+        totalNumberOfCards--;
+    }
+
+    void addCardOfValue(int cardValue) {
+        numberOfCardsOfValue[cardValue]++;
+        totalNumberOfCards++;
+    }
+
+    // Packs the counts into 64 bits (6 bits per value 1-9, since a shoe holds
+    // at most 32 of each, and 8 bits for the up to 128 ten-valued cards).
+    std::uint64_t getCompositionKey() const {
+        std::uint64_t compositionKey = numberOfCardsOfValue[10];
+        for (int cardValue = 1; cardValue <= 9; cardValue++) {
+            compositionKey = (compositionKey << 6) | numberOfCardsOfValue[cardValue];
+        }
+        return compositionKey;
+    }
+};
+
+// Probabilities of the dealer's final hand value (17 to 21) or bust.
+struct DealerOutcomeProbabilities {
+    double probabilityOfFinalHandValue[5]; // index 0 is 17, index 4 is 21
+    double probabilityOfBust;
+
+    DealerOutcomeProbabilities() {
+        for (int outcomeIndex = 0; outcomeIndex < 5; outcomeIndex++) {
+            probabilityOfFinalHandValue[outcomeIndex] = 0.0;
+        }
+        probabilityOfBust = 0.0;
+    }
+
+    double getProbabilityOfFinalHandValue(int dealerHandValue) const {
+        return probabilityOfFinalHandValue[dealerHandValue - 17];
+    }
+};
+
+// Exact distribution of the dealer's final hand, given the upcard and the
+// cards left in the shoe (the hole card and any additional card are drawn
+// from them), computed by enumerating every sequence of draws with the same
+// rules as Hand::computeHandValue and Dealer::standsOnHand.
+// Results are memoized on (upcard, composition), so repeated queries are a
+// hash lookup.
+template <typename HouseRules = ClassicHouseRules>
+class DealerProbabilityEngine {
+private:
+    std::unordered_map<std::uint64_t, DealerOutcomeProbabilities> memoizedOutcomesPerUpcard[11];
+
+    void addOutcomesOfDealerHand(ShoeComposition& composition, int hardHandValue, bool aceExists,
+                                 double probabilityOfHand, DealerOutcomeProbabilities& outcomes) {
+        int dealerHandValue = Hand::computeHandValue(hardHandValue, aceExists);
+        if (dealerHandValue > 21) {
+            outcomes.probabilityOfBust += probabilityOfHand;
+            return;
+        }
+        if (Dealer<HouseRules>::standsOnHand(dealerHandValue, aceExists && hardHandValue <= 11)) {
+            outcomes.probabilityOfFinalHandValue[dealerHandValue - 17] += probabilityOfHand;
+            return;
+        }
+        if (composition.totalNumberOfCards == 0) {
+            throw CustomExceptionWithErrorMessage("Error: the shoe runs out of cards before the dealer stands.");
+        }
+        int totalNumberOfCards = composition.totalNumberOfCards;
+        for (int cardValue = 1; cardValue <= 10; cardValue++) {
+            int numberOfCards = composition.numberOfCardsOfValue[cardValue];
+            if (numberOfCards == 0) {
+                continue;
+            }
+            double probabilityOfCard = static_cast<double>(numberOfCards) / totalNumberOfCards;
+            composition.numberOfCardsOfValue[cardValue]--;
+            composition.totalNumberOfCards--;
+            addOutcomesOfDealerHand(composition, hardHandValue + cardValue, aceExists || cardValue == 1,
+                                    probabilityOfHand * probabilityOfCard, outcomes);
+            composition.numberOfCardsOfValue[cardValue]++;
+            composition.totalNumberOfCards++;
+        }
+    }
+
+public:
+    // upcardValue is 1 (ace) to 10; the upcard is not part of the composition.
+    DealerOutcomeProbabilities computeDealerOutcomeProbabilities(int upcardValue, const ShoeComposition& composition) {
+        if (upcardValue < 1 || upcardValue > 10) {
+            throw CustomExceptionWithErrorMessage("Error: the dealer's upcard value must be between 1 and 10.");
+        }
+        std::unordered_map<std::uint64_t, DealerOutcomeProbabilities>& memoizedOutcomes = memoizedOutcomesPerUpcard[upcardValue];
+        std::uint64_t compositionKey = composition.getCompositionKey();
+        std::unordered_map<std::uint64_t, DealerOutcomeProbabilities>::iterator memoizedEntry = memoizedOutcomes.find(compositionKey);
+        if (memoizedEntry != memoizedOutcomes.end()) {
+            return memoizedEntry->second;
+        }
+        DealerOutcomeProbabilities outcomes;
+        ShoeComposition remainingComposition = composition;
+        addOutcomesOfDealerHand(remainingComposition, upcardValue, upcardValue == 1, 1.0, outcomes);
+        memoizedOutcomes[compositionKey] = outcomes;
+        return outcomes;
+    }
+
+    int getNumberOfMemoizedCompositions() {
+        int numberOfMemoizedCompositions = 0;
+        for (int upcardValue = 1; upcardValue <= 10; upcardValue++) {
+            numberOfMemoizedCompositions += memoizedOutcomesPerUpcard[upcardValue].size();
+        }
+        return numberOfMemoizedCompositions;
+    }
+};
+
+// Basic strategy for a set of house rules (whether the dealer hits soft-17,
+// and which of doubling down, splitting and surrendering are allowed), derived
+// at compile time from the expected value of every play on every hand against
+// every dealer upcard. Any 21 stands.
+// The derivation draws cards with infinite-deck probabilities (4/13 for
+// ten-valued cards, 1/13 for the others), which is standard practice for
+// basic strategy charts. Resplitting, and the extra payout of a natural (which
+// is never a decision), are not considered. When the dealer peeks for a
+// natural under an ace or a 10-valued upcard, the dealer's outcomes are
+// those of a hole card that is not a natural.
+
+// hitMaskPerHandValue[soft][handValue] has bit upcardValue (1 = ace to 10)
+// set when the player should hit.
+struct BasicStrategyTable {
+    std::uint16_t hitMaskPerHandValue[2][22];
+    std::uint16_t doubleDownMaskPerHandValue[2][22]; // 2-card hands only
+    std::uint16_t surrenderMaskPerHandValue[2][22]; // 2-card hands only
+    std::uint16_t splitMaskPerPairCardValue[11];
+};
+
+template <typename HouseRules>
+class BasicStrategyDerivation {
+private:
+    static constexpr double probabilityOfCardValue(int cardValue) {
+        return (cardValue == 10) ? 4.0 / 13.0 : 1.0 / 13.0;
+    }
+
+    // Outcome index 0 to 4 is a final hand value of 17 to 21, index 5 is a bust.
+    struct DealerOutcomeTable {
+        double probabilityOfOutcome[27][2][6]; // [hard hand value][ace exists][outcome]
+    };
+
+    static constexpr DealerOutcomeTable createDealerOutcomeTable() {
+        DealerOutcomeTable dealerOutcomes = {};
+        // Drawing only increases the hard hand value, so higher values are complete first.
+        for (int hardHandValue = 26; hardHandValue >= 1; hardHandValue--) {
+            for (int aceExists = 0; aceExists <= 1; aceExists++) {
+                int dealerHandValue = Hand::computeHandValue(hardHandValue, aceExists == 1);
+                bool dealerHasSoftHand = aceExists == 1 && hardHandValue <= 11;
+                double* probabilityOfOutcome = dealerOutcomes.probabilityOfOutcome[hardHandValue][aceExists];
+                if (dealerHandValue > 21) {
+                    probabilityOfOutcome[5] = 1.0;
+                } else if (Dealer<HouseRules>::standsOnHand(dealerHandValue, dealerHasSoftHand)) {
+                    probabilityOfOutcome[dealerHandValue - 17] = 1.0;
+                } else {
+                    for (int cardValue = 1; cardValue <= 10; cardValue++) {
+                        int aceExistsAfterCard = (aceExists == 1 || cardValue == 1) ? 1 : 0;
+                        for (int outcomeIndex = 0; outcomeIndex < 6; outcomeIndex++) {
+                            probabilityOfOutcome[outcomeIndex] += probabilityOfCardValue(cardValue) *
+                                dealerOutcomes.probabilityOfOutcome[hardHandValue + cardValue][aceExistsAfterCard][outcomeIndex];
+                        }
+                    }
+                }
+            }
+        }
+        return dealerOutcomes;
+    }
+
+    static constexpr double computeExpectedValueOfStanding(int playerHandValue, const double* probabilityOfDealerOutcome) {
+        double expectedValue = probabilityOfDealerOutcome[5]; // dealer busts
+        for (int dealerHandValue = 17; dealerHandValue <= 21; dealerHandValue++) {
+            if (playerHandValue > dealerHandValue) {
+                expectedValue += probabilityOfDealerOutcome[dealerHandValue - 17];
+            } else if (playerHandValue < dealerHandValue) {
+                expectedValue -= probabilityOfDealerOutcome[dealerHandValue - 17];
+            }
+        }
+        return expectedValue;
+    }
+
+public:
+    static constexpr BasicStrategyTable createStrategyTable() {
+        BasicStrategyTable strategyTable = {};
+        DealerOutcomeTable dealerOutcomes = createDealerOutcomeTable();
+        for (int upcardValue = 1; upcardValue <= 10; upcardValue++) {
+            const double* probabilityOfDealerOutcome = dealerOutcomes.probabilityOfOutcome[upcardValue][upcardValue == 1 ? 1 : 0];
+            double probabilityOfDealerOutcomeWithoutNatural[6] = {};
+            int holeCardValueOfNatural = (upcardValue == 1) ? 10 : ((upcardValue == 10) ? 1 : 0);
+            if (HouseRules::dealerPeeksForNatural && holeCardValueOfNatural != 0) {
+                // The player only decides when the dealer has peeked and has no natural.
+                for (int cardValue = 1; cardValue <= 10; cardValue++) {
+                    if (cardValue == holeCardValueOfNatural) {
+                        continue;
+                    }
+                    double probabilityOfHoleCard = probabilityOfCardValue(cardValue) / (1.0 - probabilityOfCardValue(holeCardValueOfNatural));
+                    int aceExistsAfterCard = (upcardValue == 1 || cardValue == 1) ? 1 : 0;
+                    for (int outcomeIndex = 0; outcomeIndex < 6; outcomeIndex++) {
+                        probabilityOfDealerOutcomeWithoutNatural[outcomeIndex] += probabilityOfHoleCard *
+                            dealerOutcomes.probabilityOfOutcome[upcardValue + cardValue][aceExistsAfterCard][outcomeIndex];
+                    }
+                }
+                probabilityOfDealerOutcome = probabilityOfDealerOutcomeWithoutNatural;
+            }
+            double expectedValueOfBestPlay[31][2] = {}; // [hard hand value][ace exists]
+            for (int hardHandValue = 30; hardHandValue >= 2; hardHandValue--) {
+                for (int aceExists = 0; aceExists <= 1; aceExists++) {
+                    int playerHandValue = Hand::computeHandValue(hardHandValue, aceExists == 1);
+                    if (playerHandValue > 21) {
+                        expectedValueOfBestPlay[hardHandValue][aceExists] = -1.0; // player busts
+                        continue;
+                    }
+                    double expectedValueOfStanding = computeExpectedValueOfStanding(playerHandValue, probabilityOfDealerOutcome);
+                    if (playerHandValue == 21) {
+                        expectedValueOfBestPlay[hardHandValue][aceExists] = expectedValueOfStanding; // 21 always stands
+                        continue;
+                    }
+                    double expectedValueOfHitting = 0.0;
+                    for (int cardValue = 1; cardValue <= 10; cardValue++) {
+                        int aceExistsAfterCard = (aceExists == 1 || cardValue == 1) ? 1 : 0;
+                        expectedValueOfHitting += probabilityOfCardValue(cardValue) *
+                            expectedValueOfBestPlay[hardHandValue + cardValue][aceExistsAfterCard];
+                    }
+                    if (expectedValueOfHitting > expectedValueOfStanding) {
+                        expectedValueOfBestPlay[hardHandValue][aceExists] = expectedValueOfHitting;
+                        bool softHand = aceExists == 1 && hardHandValue <= 11;
+                        strategyTable.hitMaskPerHandValue[softHand ? 1 : 0][playerHandValue] |= static_cast<std::uint16_t>(1 << upcardValue);
+                    } else {
+                        expectedValueOfBestPlay[hardHandValue][aceExists] = expectedValueOfStanding;
+                    }
+                }
+            }
+            // A 2-card hand may also double down (taking exactly 1 more card)
+            // or surrender (losing half the bet).
+            double expectedValueOfTwoCardHand[31][2] = {}; // [hard hand value][ace exists], without surrendering
+            for (int hardHandValue = 2; hardHandValue <= 20; hardHandValue++) {
+                for (int aceExists = 0; aceExists <= 1; aceExists++) {
+                    int playerHandValue = Hand::computeHandValue(hardHandValue, aceExists == 1);
+                    bool softHand = aceExists == 1 && hardHandValue <= 11;
+                    double expectedValueOfBestPlayOnTwoCards = expectedValueOfBestPlay[hardHandValue][aceExists];
+                    if (HouseRules::doublingDownIsAllowed && playerHandValue < 21) {
+                        double expectedValueOfDoublingDown = 0.0;
+                        for (int cardValue = 1; cardValue <= 10; cardValue++) {
+                            int aceExistsAfterCard = (aceExists == 1 || cardValue == 1) ? 1 : 0;
+                            int playerHandValueAfterCard = Hand::computeHandValue(hardHandValue + cardValue, aceExistsAfterCard == 1);
+                            double expectedValueAfterCard = -1.0; // player busts
+                            if (playerHandValueAfterCard <= 21) {
+                                expectedValueAfterCard = computeExpectedValueOfStanding(playerHandValueAfterCard, probabilityOfDealerOutcome);
+                            }
+                            expectedValueOfDoublingDown += 2.0 * probabilityOfCardValue(cardValue) * expectedValueAfterCard;
+                        }
+                        if (expectedValueOfDoublingDown > expectedValueOfBestPlayOnTwoCards) {
+                            expectedValueOfBestPlayOnTwoCards = expectedValueOfDoublingDown;
+                            strategyTable.doubleDownMaskPerHandValue[softHand ? 1 : 0][playerHandValue] |= static_cast<std::uint16_t>(1 << upcardValue);
+                        }
+                    }
+                    expectedValueOfTwoCardHand[hardHandValue][aceExists] = expectedValueOfBestPlayOnTwoCards;
+                    if (HouseRules::surrenderIsAllowed && expectedValueOfBestPlayOnTwoCards < -0.5) {
+                        strategyTable.surrenderMaskPerHandValue[softHand ? 1 : 0][playerHandValue] |= static_cast<std::uint16_t>(1 << upcardValue);
+                    }
+                }
+            }
+            // Each hand of a split pair gets a 2nd card and is played on (split
+            // aces stand on their 2nd card). Resplitting is not considered.
+            for (int pairCardValue = 1; pairCardValue <= 10 && HouseRules::maximumNumberOfHands > 1; pairCardValue++) {
+                double expectedValueOfSplitHand = 0.0;
+                for (int cardValue = 1; cardValue <= 10; cardValue++) {
+                    int aceExistsAfterCard = (pairCardValue == 1 || cardValue == 1) ? 1 : 0;
+                    double expectedValueAfterCard = expectedValueOfBestPlay[pairCardValue + cardValue][aceExistsAfterCard];
+                    if (HouseRules::doublingDownAfterSplitIsAllowed) {
+                        expectedValueAfterCard = expectedValueOfTwoCardHand[pairCardValue + cardValue][aceExistsAfterCard];
+                    }
+                    if (pairCardValue == 1) {
+                        int playerHandValueAfterCard = Hand::computeHandValue(pairCardValue + cardValue, true);
+                        expectedValueAfterCard = computeExpectedValueOfStanding(playerHandValueAfterCard, probabilityOfDealerOutcome);
+                    }
+                    expectedValueOfSplitHand += probabilityOfCardValue(cardValue) * expectedValueAfterCard;
+                }
+                double expectedValueOfPlayingPair = expectedValueOfTwoCardHand[2 * pairCardValue][pairCardValue == 1 ? 1 : 0];
+                if (HouseRules::surrenderIsAllowed && expectedValueOfPlayingPair < -0.5) {
+                    expectedValueOfPlayingPair = -0.5; // surrendering
+                }
+                if (2.0 * expectedValueOfSplitHand > expectedValueOfPlayingPair) {
+                    strategyTable.splitMaskPerPairCardValue[pairCardValue] |= static_cast<std::uint16_t>(1 << upcardValue);
+                }
+            }
+        }
+        return strategyTable;
+    }
+};
+
+template <typename HouseRules = ClassicHouseRules>
+class BasicStrategy {
+private:
+    static constexpr BasicStrategyTable strategyTable = BasicStrategyDerivation<HouseRules>::createStrategyTable();
+
+public:
+    // playerHandValue is 2 to 21 and upcardValue is 1 (ace) to 10.
+    static bool playerShouldHit(int playerHandValue, bool playerHasSoftHand, int upcardValue) {
+        return (strategyTable.hitMaskPerHandValue[playerHasSoftHand][playerHandValue] >> upcardValue) & 1;
+    }
+
+    // The following apply to 2-card hands.
+    static bool playerShouldDoubleDown(int playerHandValue, bool playerHasSoftHand, int upcardValue) {
+        return (strategyTable.doubleDownMaskPerHandValue[playerHasSoftHand][playerHandValue] >> upcardValue) & 1;
+    }
+
+    static bool playerShouldSurrender(int playerHandValue, bool playerHasSoftHand, int upcardValue) {
+        return (strategyTable.surrenderMaskPerHandValue[playerHasSoftHand][playerHandValue] >> upcardValue) & 1;
+    }
+
+    // pairCardValue is 1 (a pair of aces) to 10.
+    static bool playerShouldSplit(int pairCardValue, int upcardValue) {
+        return (strategyTable.splitMaskPerPairCardValue[pairCardValue] >> upcardValue) & 1;
+    }
+};
+
+// Policies of the player in BlackjackGame. Besides BlackjackPresenter (a
+// human player), any class providing the following members can play:
+//     static const bool displaysTheGame       false, unless it also provides the displays (and isQuiet) of BlackjackPresenter
+//     int askPlayerToBetChips(int minimumBet, int maximumBet)
+//     PlayerDecision askPlayerForDecision(int playerHandValue, bool playerHasSoftHand, int dealerUpcardValue, const PlayerDecisionOptions& decisionOptions)
+//     bool askPlayerToPlayNewRound()
+// Every engine plays the round of BlackjackGame, so the player is asked for
+// decisions (which include doubling down, splitting and surrendering) alike.
+
+// Bets 2 chips (the smallest bet that can be surrendered), or the minimum bet
+// if higher, and follows the basic strategy of the house rules.
+template <typename HouseRules = ClassicHouseRules>
+class BasicStrategyPlayerPolicy {
+public:
+    static const bool displaysTheGame = false;
+
+    int askPlayerToBetChips(int minimumBet, int maximumBet) {
+        return std::max(minimumBet, std::min(2, maximumBet));
+    }
+
+    PlayerDecision askPlayerForDecision(int playerHandValue, bool playerHasSoftHand, int dealerUpcardValue, const PlayerDecisionOptions& decisionOptions) {
+        if (decisionOptions.canSplit && BasicStrategy<HouseRules>::playerShouldSplit(decisionOptions.pairCardValue, dealerUpcardValue)) {
+            return PlayerSplitsPair;
+        }
+        if (decisionOptions.canSurrender && BasicStrategy<HouseRules>::playerShouldSurrender(playerHandValue, playerHasSoftHand, dealerUpcardValue)) {
+            return PlayerSurrenders;
+        }
+        if (decisionOptions.canDoubleDown && BasicStrategy<HouseRules>::playerShouldDoubleDown(playerHandValue, playerHasSoftHand, dealerUpcardValue)) {
+            return PlayerDoublesDown;
+        }
+        if (BasicStrategy<HouseRules>::playerShouldHit(playerHandValue, playerHasSoftHand, dealerUpcardValue)) {
+            return PlayerHitsHand;
+        } else {
+            return PlayerStandsOnHand;
+        }
+    }
+
+    bool askPlayerToPlayNewRound() {
+        return true;
+    }
+};
+
+// Bets the minimum bet and plays like the dealer of the house rules (i.e.,
+// hits until their hand value is 17 or greater).
+template <typename HouseRules = ClassicHouseRules>
+class DealerRulePlayerPolicy {
+public:
+    static const bool displaysTheGame = false;
+
+    int askPlayerToBetChips(int minimumBet, int /* maximumBet */) {
+        return minimumBet;
+    }
+
+    PlayerDecision askPlayerForDecision(int playerHandValue, bool playerHasSoftHand, int /* dealerUpcardValue */, const PlayerDecisionOptions& /* decisionOptions */) {
+        if (!Dealer<HouseRules>::standsOnHand(playerHandValue, playerHasSoftHand)) {
+            return PlayerHitsHand;
+        } else {
+            return PlayerStandsOnHand;
+        }
+    }
+
+    bool askPlayerToPlayNewRound() {
+        return true;
+    }
+};
+
+// The player of a table whose bets and decisions come from outside the game
+// (see ResumableBlackjackTable): the table drives the phases of the round
+// itself, so the policy is never asked anything.
+class RemotePlayerPolicy {
+public:
+    static const bool displaysTheGame = false;
+};
+
+// Memo table shared by several threads. It is split into shards, each behind
+// its own mutex, so that threads rarely wait for each other.
+template <typename MemoizedValue>
+class ConcurrentMemoTable {
+private:
+    static const int numberOfShards = 64;
+    static const int shardIndexShift = 58; // the top 6 bits of the hashed key pick the shard
+
+    struct Shard {
+        std::mutex shardMutex;
+        std::unordered_map<std::uint64_t, MemoizedValue> memoizedValues;
+    };
+
+    Shard shards[numberOfShards];
+
+    Shard& getShard(std::uint64_t key) {
+        return shards[(key * 0x9E3779B97F4A7C15ULL) >> shardIndexShift];
+    }
+
+public:
+    bool findValue(std::uint64_t key, MemoizedValue& value) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> shardLock(shard.shardMutex);
+        typename std::unordered_map<std::uint64_t, MemoizedValue>::iterator memoizedEntry = shard.memoizedValues.find(key);
+        if (memoizedEntry == shard.memoizedValues.end()) {
+            return false;
+        }
+        value = memoizedEntry->second;
+        return true;
+    }
+
+    void storeValue(std::uint64_t key, const MemoizedValue& value) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> shardLock(shard.shardMutex);
+        shard.memoizedValues[key] = value;
+    }
+
+    long long getNumberOfValues() {
+        long long numberOfValues = 0;
+        for (int shardIndex = 0; shardIndex < numberOfShards; shardIndex++) {
+            std::lock_guard<std::mutex> shardLock(shards[shardIndex].shardMutex);
+            numberOfValues += shards[shardIndex].memoizedValues.size();
+        }
+        return numberOfValues;
+    }
+};
+
+struct HouseEdgeAnalysis {
+    double expectedNetChipsPerInitialBet;
+    double expectedChipsWageredPerInitialBet; // more than 1 with doubling down and splitting
+    long long numberOfMemoizedCompositions;
+};
+
+// Exact expected value of a round for a ruleset and a player policy, computed
+// by enumerating every draw of the player and of the dealer from the full
+// shoe rather than by sampling (as with the default penetration of 0, where
+// the shoe is full at the start of every round). Every card drawn is removed
+// from the shoe composition, hands are scored with Hand::computeHandValue, the
+// dealer draws with Dealer::standsOnHand and the decisions come from the
+// player policy, so the results are what SimulationEngine converges to.
+// When the dealer peeks for a natural, the player only decides against a
+// hole card that is not a natural, and the peeked naturals settle at once.
+// Splits are the only approximation, as usual for combinatorial analyzers:
+// each hand of a split pair is played from the shoe left when the pair was
+// split (the cards of the other hand are not removed), and the hands allowed
+// by the house rules are divided between the 2 hands up front (e.g., each
+// hand of a first split may be split once more when 4 hands are allowed).
+// The combinations of upcard and initial hand are spread over threads, and
+// the dealer's outcomes are memoized on (upcard, remaining composition) in a
+// table shared by the threads.
+template <typename PlayerPolicy, typename HouseRules>
+class HouseEdgeAnalyzer {
+private:
+    struct DealerOutcomes {
+        double probabilityOfFinalHandValue[5]; // index 0 is 17, index 4 is 21
+        double probabilityOfBust;
+        double probabilityOfNatural; // only when a natural pays 3:2 (otherwise it counts as 21)
+    };
+
+    // Expected chips per chip of the initial bet.
+    struct HandExpectation {
+        double expectedNetChips;
+        double expectedChipsWagered;
+    };
+
+    // The upcard and the 2 cards of the player (firstCardValue <= secondCardValue).
+    struct AnalysisTask {
+        int upcardValue;
+        int firstCardValue;
+        int secondCardValue;
+    };
+
+    int numberOfDecks;
+    int numberOfThreads;
+    ConcurrentMemoTable<DealerOutcomes> memoizedOutcomesPerUpcard[11];
+
+    // The value of the hole card that makes a natural under the upcard, or 0
+    // if the dealer does not peek under the upcard.
+    static int getHoleCardValueOfPeekedNatural(int upcardValue) {
+        if constexpr (HouseRules::dealerPeeksForNatural) {
+            if (upcardValue == 1) {
+                return 10;
+            } else if (upcardValue == 10) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // The probability that the players get to decide, i.e. that the hole card
+    // (drawn from the composition) does not give the dealer a peeked natural.
+    double computeProbabilityOfPlayerTurn(int upcardValue, const ShoeComposition& composition) {
+        int holeCardValueOfNatural = getHoleCardValueOfPeekedNatural(upcardValue);
+        if (holeCardValueOfNatural == 0 || composition.totalNumberOfCards == 0) {
+            return 1.0;
+        }
+        return 1.0 - static_cast<double>(composition.numberOfCardsOfValue[holeCardValueOfNatural]) / composition.totalNumberOfCards;
+    }
+
+    // When the dealer peeks under the upcard, the hole card cannot give a
+    // natural (the round would have ended before the player's turn), so the
+    // outcomes are conditioned on it.
+    void addOutcomesOfDealerHand(ShoeComposition& composition, int hardHandValue, bool aceExists, int numberOfCards,
+                                 double probabilityOfHand, DealerOutcomes& outcomes) {
+        int dealerHandValue = Hand::computeHandValue(hardHandValue, aceExists);
+        if (dealerHandValue > 21) {
+            outcomes.probabilityOfBust += probabilityOfHand;
+            return;
+        }
+        if (HouseRules::blackjackPaysThreeToTwo && numberOfCards == 2 && dealerHandValue == 21) {
+            outcomes.probabilityOfNatural += probabilityOfHand;
+            return;
+        }
+        if (Dealer<HouseRules>::standsOnHand(dealerHandValue, aceExists && hardHandValue <= 11)) {
+            outcomes.probabilityOfFinalHandValue[dealerHandValue - 17] += probabilityOfHand;
+            return;
+        }
+        if (composition.totalNumberOfCards == 0) {
+            throw CustomExceptionWithErrorMessage("Error: the shoe runs out of cards before the dealer stands.");
+        }
+        int totalNumberOfCards = composition.totalNumberOfCards;
+        int holeCardValueOfNatural = (numberOfCards == 1) ? getHoleCardValueOfPeekedNatural(hardHandValue) : 0;
+        if (holeCardValueOfNatural != 0) {
+            totalNumberOfCards -= composition.numberOfCardsOfValue[holeCardValueOfNatural];
+            if (totalNumberOfCards == 0) {
+                return; // the player's turn never comes
+            }
+        }
+        for (int cardValue = 1; cardValue <= 10; cardValue++) {
+            int numberOfCardsOfValue = composition.numberOfCardsOfValue[cardValue];
+            if (numberOfCardsOfValue == 0 || cardValue == holeCardValueOfNatural) {
+                continue;
+            }
+            double probabilityOfCard = static_cast<double>(numberOfCardsOfValue) / totalNumberOfCards;
+            composition.removeCardOfValue(cardValue);
+            addOutcomesOfDealerHand(composition, hardHandValue + cardValue, aceExists || cardValue == 1, numberOfCards + 1,
+                                    probabilityOfHand * probabilityOfCard, outcomes);
+            composition.addCardOfValue(cardValue);
+        }
+    }
+
+    // Threads may both compute a missing entry; they store the same outcomes.
+    DealerOutcomes getDealerOutcomes(int upcardValue, ShoeComposition& composition) {
+        std::uint64_t compositionKey = composition.getCompositionKey();
+        DealerOutcomes outcomes = {};
+        if (memoizedOutcomesPerUpcard[upcardValue].findValue(compositionKey, outcomes)) {
+            return outcomes;
+        }
+        addOutcomesOfDealerHand(composition, upcardValue, upcardValue == 1, 1, 1.0, outcomes);
+        memoizedOutcomesPerUpcard[upcardValue].storeValue(compositionKey, outcomes);
+        return outcomes;
+    }
+
+    double computeExpectedValueOfStanding(int playerHandValue, bool playerHasNatural, const DealerOutcomes& outcomes) {
+        if constexpr (HouseRules::blackjackPaysThreeToTwo) {
+            if (playerHasNatural) {
+                return 1.5 * (1.0 - outcomes.probabilityOfNatural); // pushes with the dealer's natural
+            }
+        }
+        double expectedValue = outcomes.probabilityOfBust - outcomes.probabilityOfNatural;
+        for (int dealerHandValue = 17; dealerHandValue <= 21; dealerHandValue++) {
+            if (playerHandValue > dealerHandValue) {
+                expectedValue += outcomes.probabilityOfFinalHandValue[dealerHandValue - 17];
+            } else if (playerHandValue < dealerHandValue) {
+                expectedValue -= outcomes.probabilityOfFinalHandValue[dealerHandValue - 17];
+            }
+        }
+        return expectedValue;
+    }
+
+    // 1 hand of a split pair, which receives its 2nd card and may grow into
+    // up to numberOfHandsAllowed hands. Split aces stand on their 2nd card.
+    HandExpectation computeExpectationOfSplitHand(PlayerPolicy& playerPolicy, ShoeComposition& composition, int upcardValue,
+                                                  int pairCardValue, int numberOfHandsAllowed) {
+        HandExpectation handExpectation = {0.0, 0.0};
+        int totalNumberOfCards = composition.totalNumberOfCards;
+        for (int cardValue = 1; cardValue <= 10; cardValue++) {
+            int numberOfCardsOfValue = composition.numberOfCardsOfValue[cardValue];
+            if (numberOfCardsOfValue == 0) {
+                continue;
+            }
+            double probabilityOfCard = static_cast<double>(numberOfCardsOfValue) / totalNumberOfCards;
+            composition.removeCardOfValue(cardValue);
+            HandExpectation expectationAfterCard = {0.0, 1.0};
+            if (pairCardValue == 1) {
+                int playerHandValueAfterCard = Hand::computeHandValue(1 + cardValue, true);
+                double probabilityOfPlayerTurn = computeProbabilityOfPlayerTurn(upcardValue, composition);
+                expectationAfterCard.expectedNetChips = probabilityOfPlayerTurn *
+                    computeExpectedValueOfStanding(playerHandValueAfterCard, false, getDealerOutcomes(upcardValue, composition));
+                expectationAfterCard.expectedChipsWagered = probabilityOfPlayerTurn;
+            } else {
+                int pairCardValueAfterCard = (cardValue == pairCardValue) ? pairCardValue : 0;
+                expectationAfterCard = computeExpectationOfHand(playerPolicy, composition, upcardValue, pairCardValue + cardValue, cardValue == 1,
+                                                                2, true, pairCardValueAfterCard, numberOfHandsAllowed);
+            }
+            composition.addCardOfValue(cardValue);
+            handExpectation.expectedNetChips += probabilityOfCard * expectationAfterCard.expectedNetChips;
+            handExpectation.expectedChipsWagered += probabilityOfCard * expectationAfterCard.expectedChipsWagered;
+        }
+        return handExpectation;
+    }
+
+    // The hand is played from the cards left in the shoe, which the hole card
+    // and every later card are drawn from. pairCardValue is the value of a
+    // 2-card pair, and 0 otherwise; the pair may be split if
+    // numberOfHandsAllowed is at least 2. When the dealer peeks, every final
+    // hand is weighted by the probability that the hole card is not a natural
+    // (drawn from the same shoe), and analyzeTask adds the peeked naturals.
+    HandExpectation computeExpectationOfHand(PlayerPolicy& playerPolicy, ShoeComposition& composition, int upcardValue,
+                                             int hardHandValue, bool aceExists, int numberOfCards, bool isSplitHand,
+                                             int pairCardValue, int numberOfHandsAllowed) {
+        double probabilityOfPlayerTurn = computeProbabilityOfPlayerTurn(upcardValue, composition);
+        HandExpectation handExpectation = {0.0, probabilityOfPlayerTurn};
+        int playerHandValue = Hand::computeHandValue(hardHandValue, aceExists);
+        bool playerHasSoftHand = aceExists && hardHandValue <= 11;
+        if (playerHandValue > 21) {
+            handExpectation.expectedNetChips = -probabilityOfPlayerTurn;
+            return handExpectation;
+        }
+        if (playerHandValue == 21) {
+            bool playerHasNatural = !isSplitHand && numberOfCards == 2;
+            handExpectation.expectedNetChips = probabilityOfPlayerTurn *
+                computeExpectedValueOfStanding(21, playerHasNatural, getDealerOutcomes(upcardValue, composition));
+            return handExpectation;
+        }
+        PlayerDecisionOptions decisionOptions;
+        decisionOptions.canDoubleDown = HouseRules::doublingDownIsAllowed && numberOfCards == 2 &&
+                                        (!isSplitHand || HouseRules::doublingDownAfterSplitIsAllowed);
+        decisionOptions.canSplit = pairCardValue > 0 && numberOfHandsAllowed >= 2;
+        decisionOptions.canSurrender = HouseRules::surrenderIsAllowed && numberOfCards == 2 && !isSplitHand;
+        decisionOptions.pairCardValue = pairCardValue;
+        PlayerDecision playerDecision = playerPolicy.askPlayerForDecision(playerHandValue, playerHasSoftHand, upcardValue, decisionOptions);
+        if (playerDecision == PlayerSurrenders) {
+            handExpectation.expectedNetChips = -0.5 * probabilityOfPlayerTurn;
+            return handExpectation;
+        }
+        if (playerDecision == PlayerStandsOnHand) {
+            handExpectation.expectedNetChips = probabilityOfPlayerTurn *
+                computeExpectedValueOfStanding(playerHandValue, false, getDealerOutcomes(upcardValue, composition));
+            return handExpectation;
+        }
+        if (playerDecision == PlayerSplitsPair) {
+            int numberOfHandsAllowedForFirstHand = (numberOfHandsAllowed + 1) / 2;
+            HandExpectation firstHandExpectation = computeExpectationOfSplitHand(playerPolicy, composition, upcardValue, pairCardValue,
+                                                                                 numberOfHandsAllowedForFirstHand);
+            HandExpectation secondHandExpectation = firstHandExpectation;
+            if (numberOfHandsAllowed / 2 != numberOfHandsAllowedForFirstHand) {
+                secondHandExpectation = computeExpectationOfSplitHand(playerPolicy, composition, upcardValue, pairCardValue, numberOfHandsAllowed / 2);
+            }
+            handExpectation.expectedNetChips = firstHandExpectation.expectedNetChips + secondHandExpectation.expectedNetChips;
+            handExpectation.expectedChipsWagered = firstHandExpectation.expectedChipsWagered + secondHandExpectation.expectedChipsWagered;
+            return handExpectation;
+        }
+        handExpectation.expectedChipsWagered = 0.0;
+        int totalNumberOfCards = composition.totalNumberOfCards;
+        for (int cardValue = 1; cardValue <= 10; cardValue++) {
+            int numberOfCardsOfValue = composition.numberOfCardsOfValue[cardValue];
+            if (numberOfCardsOfValue == 0) {
+                continue;
+            }
+            double probabilityOfCard = static_cast<double>(numberOfCardsOfValue) / totalNumberOfCards;
+            composition.removeCardOfValue(cardValue);
+            HandExpectation expectationAfterCard = {0.0, 1.0};
+            if (playerDecision == PlayerHitsHand) {
+                expectationAfterCard = computeExpectationOfHand(playerPolicy, composition, upcardValue, hardHandValue + cardValue,
+                                                                aceExists || cardValue == 1, numberOfCards + 1, isSplitHand, 0, 0);
+            } else if (playerDecision == PlayerDoublesDown) {
+                int playerHandValueAfterCard = Hand::computeHandValue(hardHandValue + cardValue, aceExists || cardValue == 1);
+                double probabilityOfPlayerTurnAfterCard = computeProbabilityOfPlayerTurn(upcardValue, composition);
+                expectationAfterCard.expectedNetChips = -2.0 * probabilityOfPlayerTurnAfterCard; // player busts
+                expectationAfterCard.expectedChipsWagered = 2.0 * probabilityOfPlayerTurnAfterCard;
+                if (playerHandValueAfterCard <= 21) {
+                    expectationAfterCard.expectedNetChips = 2.0 * probabilityOfPlayerTurnAfterCard *
+                        computeExpectedValueOfStanding(playerHandValueAfterCard, false, getDealerOutcomes(upcardValue, composition));
+                }
+            }
+            composition.addCardOfValue(cardValue);
+            handExpectation.expectedNetChips += probabilityOfCard * expectationAfterCard.expectedNetChips;
+            handExpectation.expectedChipsWagered += probabilityOfCard * expectationAfterCard.expectedChipsWagered;
+        }
+        return handExpectation;
+    }
+
+    // Weighted by the probability of the upcard and the initial hand, dealt in
+    // the order of BlackjackGame (the player's 2 cards, then the upcard).
+    HandExpectation analyzeTask(PlayerPolicy& playerPolicy, const AnalysisTask& task) {
+        ShoeComposition composition = ShoeComposition::createFullShoe(numberOfDecks);
+        double probabilityOfTask = 1.0;
+        int dealtCardValues[3] = {task.firstCardValue, task.secondCardValue, task.upcardValue};
+        for (int cardIndex = 0; cardIndex < 3; cardIndex++) {
+            probabilityOfTask *= static_cast<double>(composition.numberOfCardsOfValue[dealtCardValues[cardIndex]]) / composition.totalNumberOfCards;
+            composition.removeCardOfValue(dealtCardValues[cardIndex]);
+        }
+        if (task.firstCardValue != task.secondCardValue) {
+            probabilityOfTask *= 2.0; // either card may come first
+        }
+        int pairCardValue = (task.firstCardValue == task.secondCardValue) ? task.firstCardValue : 0;
+        HandExpectation handExpectation = computeExpectationOfHand(playerPolicy, composition, task.upcardValue,
+                                                                   task.firstCardValue + task.secondCardValue,
+                                                                   task.firstCardValue == 1 || task.secondCardValue == 1, 2, false, pairCardValue,
+                                                                   HouseRules::maximumNumberOfHands);
+        int holeCardValueOfNatural = getHoleCardValueOfPeekedNatural(task.upcardValue);
+        if (holeCardValueOfNatural != 0) {
+            // The dealer peeks and has a natural: the initial bet loses, unless the player has a natural too.
+            double probabilityOfPeekedNatural = 1.0 - computeProbabilityOfPlayerTurn(task.upcardValue, composition);
+            bool playerHasNatural = task.firstCardValue + task.secondCardValue == 11 && task.firstCardValue == 1;
+            if (!playerHasNatural) {
+                handExpectation.expectedNetChips -= probabilityOfPeekedNatural;
+            }
+            handExpectation.expectedChipsWagered += probabilityOfPeekedNatural;
+        }
+        handExpectation.expectedNetChips *= probabilityOfTask;
+        handExpectation.expectedChipsWagered *= probabilityOfTask;
+        return handExpectation;
+    }
+
+    void analyzeTasks(const std::vector<AnalysisTask>& tasks, std::atomic<int>& nextTaskIndex,
+                      std::vector<HandExpectation>& expectationPerTask) {
+        PlayerPolicy playerPolicy; // 1 per thread
+        int taskIndex = nextTaskIndex.fetch_add(1, std::memory_order_relaxed);
+        while (taskIndex < static_cast<int>(tasks.size())) {
+            expectationPerTask[taskIndex] = analyzeTask(playerPolicy, tasks[taskIndex]);
+            taskIndex = nextTaskIndex.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    HouseEdgeAnalyzer(int decks, int threads) {
+        if (decks < Deck::minimumNumberOfDecksInShoe || decks > Deck::maximumNumberOfDecksInShoe) {
+            throw CustomExceptionWithErrorMessage("Error: the dealing shoe must contain between 1 and 8 decks.");
+        }
+        if (threads < 1) {
+            throw CustomExceptionWithErrorMessage("Error: an analysis needs at least 1 thread.");
+        }
+        numberOfDecks = decks;
+        numberOfThreads = threads;
+    }
+
+    HouseEdgeAnalyzer(const HouseEdgeAnalyzer&) = delete;
+    HouseEdgeAnalyzer& operator=(const HouseEdgeAnalyzer&) = delete;
+
+    // The tasks are summed in a fixed order, so the results do not depend on
+    // the number of threads.
+    HouseEdgeAnalysis analyzeHouseEdge() {
+        std::vector<AnalysisTask> tasks;
+        for (int upcardValue = 1; upcardValue <= 10; upcardValue++) {
+            for (int firstCardValue = 1; firstCardValue <= 10; firstCardValue++) {
+                for (int secondCardValue = firstCardValue; secondCardValue <= 10; secondCardValue++) {
+                    AnalysisTask task;
+                    task.upcardValue = upcardValue;
+                    task.firstCardValue = firstCardValue;
+                    task.secondCardValue = secondCardValue;
+                    tasks.push_back(task);
+                }
+            }
+        }
+        std::vector<HandExpectation> expectationPerTask(tasks.size());
+        std::atomic<int> nextTaskIndex(0);
+        std::vector<std::thread> threads;
+        for (int threadIndex = 1; threadIndex < numberOfThreads; threadIndex++) {
+            threads.push_back(std::thread(&HouseEdgeAnalyzer::analyzeTasks, this, std::cref(tasks), std::ref(nextTaskIndex),
+                                          std::ref(expectationPerTask)));
+        }
+        analyzeTasks(tasks, nextTaskIndex, expectationPerTask); // the calling thread works too
+        for (std::size_t threadIndex = 0; threadIndex < threads.size(); threadIndex++) {
+            threads[threadIndex].join();
+        }
+        HouseEdgeAnalysis analysis;
+        analysis.expectedNetChipsPerInitialBet = 0.0;
+        analysis.expectedChipsWageredPerInitialBet = 0.0;
+        for (std::size_t taskIndex = 0; taskIndex < tasks.size(); taskIndex++) {
+            analysis.expectedNetChipsPerInitialBet += expectationPerTask[taskIndex].expectedNetChips;
+            analysis.expectedChipsWageredPerInitialBet += expectationPerTask[taskIndex].expectedChipsWagered;
+        }
+        analysis.numberOfMemoizedCompositions = 0;
+        for (int upcardValue = 1; upcardValue <= 10; upcardValue++) {
+            analysis.numberOfMemoizedCompositions += memoizedOutcomesPerUpcard[upcardValue].getNumberOfValues();
+        }
+        return analysis;
+    }
+};
+
+enum RoundOutcome {
+    PlayerWinsRound = 0,
+    PlayerPushesRound = 1,
+    PlayerLosesRound = 2
+};
+
+struct RoundResult {
+    RoundOutcome roundOutcome;
+    int playerBetInChips;
+    int playerNetChips; // chips won (positive) or lost (negative) in the round
+};
+
+// A completed round as a fixed-size (64-byte) binary record of the round log.
+// The seed of the session and the position in the shoe of the first card of
+// the round locate the round in its shoe. Cards are stored as card codes, the
+// player's cards first and then the dealer's cards. A round with more cards
+// than the record holds (possible after splitting) keeps all of the dealer's
+// cards and the first cards of the player, and is flagged as truncated.
+// Records are written in the byte order of the machine.
+struct RoundLogRecord {
+    static const int maximumNumberOfCardsInRecord = 36;
+    static const std::uint8_t cardsAreTruncatedFlag = 1; // bit of recordFlags
+
+    std::uint64_t sessionSeed;
+    std::int32_t shoePosition;
+    std::int32_t playerBetInChips;
+    std::int32_t playerNetChips;
+    std::int32_t playerChipsAfterRound;
+    std::uint8_t roundOutcome;
+    std::uint8_t numberOfPlayerCards;
+    std::uint8_t numberOfDealerCards;
+    std::uint8_t recordFlags;
+    std::uint8_t cardCodes[maximumNumberOfCardsInRecord];
+};
+
+static_assert(sizeof(RoundLogRecord) == 64, "A round log record must stay 64 bytes long.");
+
+// Round log being written. Records are written at given record positions, so
+// that several threads can each write their own part of the file.
+class RoundLogFile {
+private:
+    int fileDescriptor;
+
+public:
+    RoundLogFile(const std::string& filePath) {
+        fileDescriptor = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fileDescriptor < 0) {
+            throw CustomExceptionWithErrorMessage("Error: cannot create round log '" + filePath + "'.");
+        }
+    }
+
+    RoundLogFile(const RoundLogFile&) = delete;
+    RoundLogFile& operator=(const RoundLogFile&) = delete;
+
+    ~RoundLogFile() {
+        close(fileDescriptor);
+    }
+
+    void writeRecords(const RoundLogRecord* records, std::size_t numberOfRecords, long long indexOfFirstRecord) {
+        const char* bytesToWrite = reinterpret_cast<const char*>(records);
+        std::size_t numberOfBytesToWrite = numberOfRecords * sizeof(RoundLogRecord);
+        off_t fileOffset = static_cast<off_t>(indexOfFirstRecord) * sizeof(RoundLogRecord);
+        while (numberOfBytesToWrite > 0) {
+            ssize_t numberOfBytesWritten = pwrite(fileDescriptor, bytesToWrite, numberOfBytesToWrite, fileOffset);
+            if (numberOfBytesWritten <= 0) {
+                throw CustomExceptionWithErrorMessage("Error: cannot write to the round log.");
+            }
+            bytesToWrite += numberOfBytesWritten;
+            numberOfBytesToWrite -= numberOfBytesWritten;
+            fileOffset += numberOfBytesWritten;
+        }
+    }
+};
+
+// Buffers consecutive records and writes them to the round log in large
+// blocks. The records still buffered are written by flushRecords(), or at the
+// latest by the destructor, so that they are not lost when the game ends with
+// an exception (e.g., when a script runs out of answers).
+class RoundLogWriter {
+private:
+    static const int numberOfBufferedRecords = 1 << 14; // 1 MiB blocks
+
+    RoundLogFile& roundLogFile;
+    std::vector<RoundLogRecord> bufferedRecords; // capacity is reserved once
+    long long indexOfFirstBufferedRecord;
+
+public:
+    RoundLogWriter(RoundLogFile& logFile, long long indexOfFirstRecord) : roundLogFile(logFile) {
+        bufferedRecords.reserve(numberOfBufferedRecords);
+        indexOfFirstBufferedRecord = indexOfFirstRecord;
+    }
+
+    RoundLogWriter(const RoundLogWriter&) = delete;
+    RoundLogWriter& operator=(const RoundLogWriter&) = delete;
+
+    // A destructor must not throw: an error writing the last records is only
+    // reported by an explicit flushRecords().
+    ~RoundLogWriter() {
+        try {
+            flushRecords();
+        }
+        catch (const std::exception& e) {
+        }
+    }
+
+    void appendRecord(const RoundLogRecord& record) {
+        bufferedRecords.push_back(record);
+        if (bufferedRecords.size() == numberOfBufferedRecords) {
+            flushRecords();
+        }
+    }
+
+    void flushRecords() {
+        if (!bufferedRecords.empty()) {
+            roundLogFile.writeRecords(bufferedRecords.data(), bufferedRecords.size(), indexOfFirstBufferedRecord);
+            indexOfFirstBufferedRecord += bufferedRecords.size();
+            bufferedRecords.clear();
+        }
+    }
+
+    // The next records are written from the given record position on.
+    void moveToRecord(long long recordIndex) {
+        flushRecords();
+        indexOfFirstBufferedRecord = recordIndex;
+    }
+};
+
+// The Blackjack game, with the decisions of the player made by the
+// PlayerPolicy (see BlackjackPresenter and the policies above). All calls to
+// the policy are resolved at compile time, and a policy that does not display
+// the game compiles the displays away.
+// The table has 1 to 7 seats (see SeatArrays) against 1 dealer and 1 shoe,
+// and every seat is played by the PlayerPolicy; the game is only displayed
+// at a table of 1 seat.
+template <typename PlayerPolicy, typename RandomNumberGenerator = Xoshiro256StarStarGenerator, typename HouseRules = ClassicHouseRules>
+class BlackjackGame {
+private:
+    Dealer<HouseRules> dealer;
+    SeatArrays<HouseRules> tableSeats;
+    int numberOfSeats;
+    int indexOfCurrentSeat; // the seat being dealt, played or settled
+    int indexOfCurrentHand; // the hand of the current seat (more than 1 after splitting pairs)
+    bool currentHandIsOver; // no more decisions on the current hand (e.g., after doubling down)
+    Deck deck;
+    RandomNumberGenerator randomNumberGenerator;
+    PlayerPolicy playerPolicy;
+    RoundResult roundResultPerSeat[SeatLimits::maximumNumberOfSeats];
+    std::string handInTextFormatBuffer; // reused by every display of a hand
+    RoundLogWriter* roundLogWriter; // every completed round is logged, unless nullptr
+    std::uint64_t sessionSeed;
+    int shoePositionAtStartOfRound;
+    int playerChipsAtStartOfRoundPerSeat[SeatLimits::maximumNumberOfSeats];
+
+    void gameStarts() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.displayWelcomeMessage();
+        }
+    }
+
+    void gameEnds() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.displayGoodbyeMessage();
+        }
+    }
+
+    // Algorithm for a Blackjack round:
+    //     If the cut card is reached, place reshuffled shoe into dealing shoe
+    //     Each player bets (in the order of the seats)
+    //     Deal 1 card to each player, then a 2nd card to each player
+    //     Display player's initial cards (i.e., 2 cards)
+    //     Deal 2 cards to dealer
+    //     Display dealer's first card
+    //     Hide dealer's second card (called the hole card)
+    //     If the house rules say so and dealer's first card is an ace or 10-valued
+    //         Dealer checks the hole card; with a natural, no player decides
+    //     For each player (in the order of the seats)
+    //         For each hand of the player (more than 1 after splitting pairs)
+    //             If the hand was split, deal its 2nd card
+    //             Player hits, stands, doubles down, splits or surrenders
+    //             If player busts
+    //                 Player loses (the hand is settled at once)
+    //             If player surrenders
+    //                 Half of the bet is returned (the hand is settled at once)
+    //     If any hand of any player is not settled
+    //         Display dealer's second card (namely, the hole card)
+    //         Deal additional cards to dealer
+    //     For each hand of each player that is not settled
+    //         If dealer busts
+    //             Player wins
+    //         If player's hand value is greater than dealer's hand value
+    //             Player wins
+    //         If player's hand value is less than dealer's hand value
+    //             Player loses
+    //         If player's hand value equals dealer's hand value
+    //             Player pushes
+    //     Blackjack round is over
+    //     Discard all cards (namely, players' hands and dealer's hand)
+
+    void roundStarts() {
+        startRound();
+        playersPlaceBets();
+        dealInitialCards();
+        dealAdditionalCardsToPlayers();
+        dealerPlaysHand();
+        settlePlayerHands();
+    }
+
+    // The round log records tables of 1 seat (see setRoundLogWriter).
+    void logRound() {
+        RoundLogRecord record;
+        record.sessionSeed = sessionSeed;
+        record.shoePosition = shoePositionAtStartOfRound;
+        record.playerBetInChips = roundResultPerSeat[0].playerBetInChips;
+        record.playerChipsAfterRound = tableSeats.getCurrentNumberOfChipsToPlay(0);
+        record.playerNetChips = roundResultPerSeat[0].playerNetChips;
+        record.roundOutcome = roundResultPerSeat[0].roundOutcome;
+        // The cards of split hands are logged one hand after the other.
+        int numberOfPlayerCards = 0;
+        for (int playerHandIndex = 0; playerHandIndex < tableSeats.getNumberOfHands(0); playerHandIndex++) {
+            numberOfPlayerCards += tableSeats.getNumberOfCardsInHand(0, playerHandIndex);
+        }
+        record.numberOfDealerCards = dealer.getNumberOfCardsInHand();
+        record.recordFlags = 0;
+        if (numberOfPlayerCards + record.numberOfDealerCards > RoundLogRecord::maximumNumberOfCardsInRecord) {
+            numberOfPlayerCards = RoundLogRecord::maximumNumberOfCardsInRecord - record.numberOfDealerCards;
+            record.recordFlags |= RoundLogRecord::cardsAreTruncatedFlag;
+        }
+        record.numberOfPlayerCards = numberOfPlayerCards;
+        int cardIndex = 0;
+        for (int playerHandIndex = 0; playerHandIndex < tableSeats.getNumberOfHands(0); playerHandIndex++) {
+            for (int handIndex = 0; handIndex < tableSeats.getNumberOfCardsInHand(0, playerHandIndex) && cardIndex < numberOfPlayerCards; handIndex++) {
+                record.cardCodes[cardIndex++] = tableSeats.getCardAtPosition(0, playerHandIndex, handIndex).getCardCode();
+            }
+        }
+        for (int handIndex = 0; handIndex < record.numberOfDealerCards; handIndex++) {
+            record.cardCodes[cardIndex++] = dealer.getCardAtPosition(handIndex).getCardCode();
+        }
+        while (cardIndex < RoundLogRecord::maximumNumberOfCardsInRecord) {
+            record.cardCodes[cardIndex++] = 0;
+        }
+        roundLogWriter->appendRecord(record);
+    }
+
+    // All cards are put back into the dealing shoe, which is then shuffled.
+    void placeShuffledDeckIntoDealingShoe() {
+        BLACKJACK_INSTRUMENT_PHASE(ShufflePhase);
+        deck.reshuffleShoe(randomNumberGenerator);
+    }
+
+    bool isCutCardReached() {
+        return deck.isCutCardReached();
+    }
+
+    bool isDeckEmpty() {
+        return deck.isDeckEmpty();
+    }
+
+    void playersPlaceBets() {
+        for (indexOfCurrentSeat = 0; indexOfCurrentSeat < numberOfSeats; indexOfCurrentSeat++) {
+            int playerCurrentNumberOfChipsToPlay = tableSeats.getCurrentNumberOfChipsToPlay(indexOfCurrentSeat);
+            if constexpr (PlayerPolicy::displaysTheGame) {
+                playerPolicy.displayPlayerAvailableChipsToBetWith(playerCurrentNumberOfChipsToPlay);
+            }
+            int minimumBet = HouseRules::minimumBet;
+            int maximumBet = playerCurrentNumberOfChipsToPlay; // There is no limit to maximum bet.
+            playerPlacesBet(indexOfCurrentSeat, playerPolicy.askPlayerToBetChips(minimumBet, maximumBet));
+        }
+    }
+
+    bool playerHasAvailableChipsToPlay() {
+        return tableSeats.hasAvailableChipsToPlay(0);
+    }
+
+    void informPlayerAboutLackOfChips() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.displayRegretMessageNoChips();
+        }
+    }
+
+    void displayPlayerHandContents() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            if (playerPolicy.isQuiet()) {
+                return; // Hands are not even rendered.
+            }
+            handInTextFormatBuffer.clear();
+            tableSeats.appendHandInTextFormat(indexOfCurrentSeat, indexOfCurrentHand, handInTextFormatBuffer);
+            playerPolicy.displayPlayerHand(handInTextFormatBuffer);
+            int playerHandValue = getPlayerHandValue();
+            playerPolicy.displayPlayerHandValue(playerHandValue);
+        }
+    }
+
+    void hideTheHoleCardFromPlayer() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.announceSecondCardOfDealerIsHidden(); // The hole card is kept hidden for now.
+        }
+    }
+
+    // A natural is only possible under an ace or a 10-valued upcard. The peek
+    // keeps the players from doubling down, splitting or surrendering against
+    // it: every hand but a natural then loses its initial bet.
+    bool dealerPeeksAndHasNatural() {
+        if constexpr (HouseRules::dealerPeeksForNatural) {
+            int dealerUpcardValue = getDealerUpcardValue();
+            if ((dealerUpcardValue == 1 || dealerUpcardValue == 10) && dealer.hasNaturalBlackjack()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void dealCardToPlayer() {
+        if (isDeckEmpty()) {
+            placeShuffledDeckIntoDealingShoe();
+        }
+        Card playerCard = deck.drawCardfromDeck();
+        tableSeats.addCardToHand(indexOfCurrentSeat, indexOfCurrentHand, playerCard);
+    }
+
+    void dealCardToEachPlayer() {
+        indexOfCurrentHand = 0;
+        for (indexOfCurrentSeat = 0; indexOfCurrentSeat < numberOfSeats; indexOfCurrentSeat++) {
+            dealCardToPlayer();
+        }
+    }
+
+    void dealAdditionalCardsToPlayers() {
+        BLACKJACK_INSTRUMENT_PHASE(PlayerDecisionsPhase);
+        while (findNextPlayerDecision()) {
+            applyPlayerDecision(askPlayerForDecision());
+        }
+    }
+
+    // A doubled hand has taken its 1 more card.
+    bool currentHandWaitsForDecision() {
+        if (tableSeats.isHandSettled(indexOfCurrentSeat, indexOfCurrentHand) || tableSeats.isHandDoubled(indexOfCurrentSeat, indexOfCurrentHand) ||
+            tableSeats.isBusted(indexOfCurrentSeat, indexOfCurrentHand) || getPlayerHandValue() == 21) {
+            return false;
+        } else {
+            return true;
+        }
+    }
+
+    void dealSecondCardToSplitHand() {
+        dealCardToPlayer();
+        announcePlayerHandNumber();
+        displayPlayerHandContents();
+    }
+
+    void announcePlayerHandNumber() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            int numberOfHandsOfPlayer = tableSeats.getNumberOfHands(indexOfCurrentSeat);
+            if (numberOfHandsOfPlayer > 1) {
+                playerPolicy.announcePlayerHandNumber(indexOfCurrentHand + 1, numberOfHandsOfPlayer);
+            }
+        }
+    }
+
+    PlayerDecision askPlayerForDecision() {
+        int dealerUpcardValue = dealer.getUpcard().getCardValue();
+        return playerPolicy.askPlayerForDecision(getPlayerHandValue(), playerHasSoftHand(), dealerUpcardValue, getPlayerDecisionOptions());
+    }
+
+    // A hand is in play until it is settled (busted hands and surrendered
+    // hands are settled before the dealer draws).
+    bool playersHaveHandInPlay() {
+        for (int seatIndex = 0; seatIndex < numberOfSeats; seatIndex++) {
+            for (int handIndex = 0; handIndex < tableSeats.getNumberOfHands(seatIndex); handIndex++) {
+                if (!tableSeats.isHandSettled(seatIndex, handIndex)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The bets still in play were settled by SeatArrays::settleBets; only
+    // a displayed game then announces the outcome of each hand.
+    void announceSettledHandsOfCurrentPlayer(int playerChipsBeforeShowdown) {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            int playerCurrentNumberOfChipsToPlay = playerChipsBeforeShowdown;
+            for (indexOfCurrentHand = 0; indexOfCurrentHand < tableSeats.getNumberOfHands(indexOfCurrentSeat); indexOfCurrentHand++) {
+                int chipsReturned = tableSeats.getChipsReturnedAtShowdown(indexOfCurrentSeat, indexOfCurrentHand);
+                if (chipsReturned < 0) {
+                    continue; // settled before the showdown
+                }
+                announcePlayerHandNumber();
+                int betInChips = tableSeats.getBetInChips(indexOfCurrentSeat, indexOfCurrentHand);
+                if (chipsReturned > betInChips) {
+                    playerPolicy.announcePlayerWins();
+                } else if (chipsReturned == betInChips) {
+                    playerPolicy.announcePlayerPushes();
+                } else {
+                    playerPolicy.announcePlayerLoses();
+                }
+                playerCurrentNumberOfChipsToPlay += chipsReturned;
+                playerPolicy.displayPlayerCurrentNumberOfChips(playerCurrentNumberOfChipsToPlay);
+            }
+        }
+    }
+
+    // With several hands (or a surrender), the round outcome is the sign of
+    // the chips won or lost.
+    void recordRoundResultOfCurrentPlayer() {
+        RoundResult& roundResult = roundResultPerSeat[indexOfCurrentSeat];
+        roundResult.playerNetChips = tableSeats.getCurrentNumberOfChipsToPlay(indexOfCurrentSeat) - playerChipsAtStartOfRoundPerSeat[indexOfCurrentSeat];
+        if (roundResult.playerNetChips > 0) {
+            roundResult.roundOutcome = PlayerWinsRound;
+        } else if (roundResult.playerNetChips == 0) {
+            roundResult.roundOutcome = PlayerPushesRound;
+        } else {
+            roundResult.roundOutcome = PlayerLosesRound;
+        }
+    }
+
+    void playerLoses() {
+        BLACKJACK_INSTRUMENT_PHASE(SettlementPhase);
+        tableSeats.loses(indexOfCurrentSeat, indexOfCurrentHand);
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.announcePlayerLoses();
+        }
+        informPlayerAboutTheirCurrentNumberOfChips();
+    }
+
+    void playerSurrenders() {
+        BLACKJACK_INSTRUMENT_PHASE(SettlementPhase);
+        tableSeats.surrenders(indexOfCurrentSeat, indexOfCurrentHand);
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.announcePlayerSurrenders();
+        }
+        informPlayerAboutTheirCurrentNumberOfChips();
+    }
+
+    void informPlayerAboutTheirCurrentNumberOfChips() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            int playerCurrentNumberOfChipsToPlay = tableSeats.getCurrentNumberOfChipsToPlay(indexOfCurrentSeat);
+            playerPolicy.displayPlayerCurrentNumberOfChips(playerCurrentNumberOfChipsToPlay);
+        }
+    }
+
+    bool askPlayerToPlayNewRound() {
+        return playerPolicy.askPlayerToPlayNewRound();
+    }
+
+    void displayDealerHandContents() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            if (playerPolicy.isQuiet()) {
+                return; // Hands are not even rendered.
+            }
+            handInTextFormatBuffer.clear();
+            dealer.appendHandInTextFormat(handInTextFormatBuffer);
+            playerPolicy.displayDealerHand(handInTextFormatBuffer);
+            int dealerHandValue = dealer.getHandValue();
+            playerPolicy.displayDealerHandValue(dealerHandValue);
+        }
+    }
+
+    int getDealerHandValue() {
+        return dealer.getHandValue();
+    }
+
+    void dealCardToDealer() {
+        if (isDeckEmpty()) {
+            placeShuffledDeckIntoDealingShoe();
+        }
+        Card dealerCard = deck.drawCardfromDeck();
+        dealer.isHitting(dealerCard);
+    }
+
+    void dealAdditionalCardsToDealer() {
+        BLACKJACK_INSTRUMENT_PHASE(DealerDrawPhase);
+        while (!dealerStandsOnHand()) {
+            dealCardToDealer();
+            displayDealerHandContents();
+        }
+    }
+
+    bool dealerStandsOnHand() {
+        return dealer.standsOnCurrentHand();
+    }
+
+    // Discard players' hands and dealer's hand. The dealt cards stay out of
+    // the dealing shoe until it is reshuffled.
+    void discardAllCardsFromTable() {
+        tableSeats.clearHands(numberOfSeats);
+        dealer.clearHand();
+    }
+
+public:
+    // The dealing shoe contains the decks of the house rules, reshuffled
+    // between each round.
+    BlackjackGame() : BlackjackGame(HouseRules::numberOfDecks, 0.0) {
+        std::random_device randomDevice;
+        sessionSeed = (static_cast<std::uint64_t>(randomDevice()) << 32) | randomDevice();
+        randomNumberGenerator.seed(sessionSeed);
+    }
+
+    BlackjackGame(int numberOfDecks, double penetration) : BlackjackGame(1, numberOfDecks, penetration) {
+    }
+
+    BlackjackGame(int seats, int numberOfDecks, double penetration) : deck(numberOfDecks, penetration) {
+        if (seats < SeatLimits::minimumNumberOfSeats || seats > SeatLimits::maximumNumberOfSeats) {
+            throw CustomExceptionWithErrorMessage("Error: a table must have between 1 and 7 seats.");
+        }
+        if (PlayerPolicy::displaysTheGame && seats > 1) {
+            throw CustomExceptionWithErrorMessage("Error: the game is only displayed at a table of 1 seat.");
+        }
+        numberOfSeats = seats;
+        indexOfCurrentSeat = 0;
+        indexOfCurrentHand = 0;
+        currentHandIsOver = false;
+        roundLogWriter = nullptr;
+        sessionSeed = 0;
+        shoePositionAtStartOfRound = 0;
+        for (int seatIndex = 0; seatIndex < SeatLimits::maximumNumberOfSeats; seatIndex++) {
+            playerChipsAtStartOfRoundPerSeat[seatIndex] = 0;
+        }
+    }
+
+    // The writer is owned by the caller; nullptr stops the logging. The round
+    // log records tables of 1 seat.
+    void setRoundLogWriter(RoundLogWriter* writer) {
+        if (writer != nullptr && numberOfSeats > 1) {
+            throw CustomExceptionWithErrorMessage("Error: the round log only records tables of 1 seat.");
+        }
+        roundLogWriter = writer;
+    }
+
+    void beginPlaying() {
+        // A Blackjack game consists of 1 or more rounds.
+        gameStarts();
+        if (!playerHasAvailableChipsToPlay()) {
+            informPlayerAboutLackOfChips();
+            gameEnds();
+            return;
+        }
+        do {
             roundStarts();
             roundEnds();
-            if (!playerHasAvailableChipsToPlay()) {
-                informPlayerAboutLackOfChips();
-                gameEnds();
-                return;
+            if (!playerHasAvailableChipsToPlay()) {
+                informPlayerAboutLackOfChips();
+                gameEnds();
+                return;
+            }
+        } while (askPlayerToPlayNewRound() == true);
+        gameEnds();
+        return;
+    }
+
+    // Every player starts afresh with 100 chips and the shoe is ordered, then
+    // shuffled with the given seed.
+    void startNewSession(std::uint64_t seed) {
+        tableSeats = SeatArrays<HouseRules>();
+        sessionSeed = seed;
+        randomNumberGenerator.seed(seed);
+        deck.createOrderedDeck();
+        placeShuffledDeckIntoDealingShoe();
+    }
+
+    PlayerPolicy& getPlayerPolicy() {
+        return playerPolicy;
+    }
+
+    // Plays 1 round at every seat (see getSeatRoundResult).
+    void playRound() {
+        roundStarts();
+        roundEnds();
+    }
+
+    int getNumberOfSeats() {
+        return numberOfSeats;
+    }
+
+    // Result of the seat in the last round played.
+    RoundResult getSeatRoundResult(int seatIndex) {
+        return roundResultPerSeat[seatIndex];
+    }
+
+    bool playerHasChipsToPlay(int seatIndex) {
+        return tableSeats.hasAvailableChipsToPlay(seatIndex);
+    }
+
+    void playerBuysChips(int seatIndex, int newChips) {
+        tableSeats.buyChips(seatIndex, newChips);
+    }
+
+    int getPlayerCurrentNumberOfChipsToPlay(int seatIndex) {
+        return tableSeats.getCurrentNumberOfChipsToPlay(seatIndex);
+    }
+
+    // The phases of a round, for the engines that get the bets and decisions
+    // of the players from elsewhere (e.g., ResumableBlackjackTable). They are
+    // called in the order of roundStarts:
+    //     startRound
+    //     playerPlacesBet, for each seat
+    //     dealInitialCards
+    //     applyPlayerDecision, as long as findNextPlayerDecision returns true
+    //     dealerPlaysHand
+    //     settlePlayerHands (see getSeatRoundResult)
+    //     roundEnds
+    void startRound() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.announceStartOfRound();
+        }
+        if (isCutCardReached()) {
+            placeShuffledDeckIntoDealingShoe();
+        }
+        shoePositionAtStartOfRound = deck.getPositionOfNextCardToDraw();
+        for (int seatIndex = 0; seatIndex < numberOfSeats; seatIndex++) {
+            playerChipsAtStartOfRoundPerSeat[seatIndex] = tableSeats.getCurrentNumberOfChipsToPlay(seatIndex);
+        }
+    }
+
+    void playerPlacesBet(int seatIndex, int playerBetInChips) {
+        tableSeats.isBetting(seatIndex, playerBetInChips);
+        roundResultPerSeat[seatIndex].playerBetInChips = playerBetInChips;
+    }
+
+    // The players' cards are dealt round the table, 1 card at a time.
+    void dealInitialCards() {
+        BLACKJACK_INSTRUMENT_PHASE(InitialDealPhase);
+        dealCardToEachPlayer(); // players' 1st card
+        dealCardToEachPlayer(); // players' 2nd card
+        indexOfCurrentSeat = 0;
+        indexOfCurrentHand = 0;
+        displayPlayerHandContents(); // The game is only displayed at a table of 1 seat.
+        dealCardToDealer(); // dealer's 1st card
+        displayDealerHandContents();
+        dealCardToDealer(); // dealer's 2nd card (namely, the hole card)
+        hideTheHoleCardFromPlayer(); // The hole card remains hidden.
+        currentHandIsOver = false;
+        if (dealerPeeksAndHasNatural()) {
+            if constexpr (PlayerPolicy::displaysTheGame) {
+                playerPolicy.announceDealerHasNatural();
+            }
+            indexOfCurrentSeat = numberOfSeats; // No player decides (see findNextPlayerDecision).
+        }
+    }
+
+    // Moves on to the next hand waiting for a decision of its player: the
+    // hands of each seat are played in turn, and hands created by splitting
+    // are appended, so they are played in turn too. Returns false once every
+    // hand has been played.
+    bool findNextPlayerDecision() {
+        while (indexOfCurrentSeat < numberOfSeats) {
+            if (!currentHandIsOver && currentHandWaitsForDecision()) {
+                return true;
+            }
+            currentHandIsOver = false;
+            if (indexOfCurrentHand + 1 < tableSeats.getNumberOfHands(indexOfCurrentSeat)) {
+                indexOfCurrentHand++;
+                if (tableSeats.getNumberOfCardsInHand(indexOfCurrentSeat, indexOfCurrentHand) == 1) {
+                    dealSecondCardToSplitHand();
+                    currentHandIsOver = tableSeats.isHandFromSplitAces(indexOfCurrentSeat, indexOfCurrentHand); // Split aces stand on their 2nd card.
+                }
+            } else {
+                indexOfCurrentSeat++;
+                indexOfCurrentHand = 0;
+            }
+        }
+        return false;
+    }
+
+    void applyPlayerDecision(PlayerDecision playerDecision) {
+        RoundResult& roundResult = roundResultPerSeat[indexOfCurrentSeat];
+        if (playerDecision == PlayerStandsOnHand) {
+            currentHandIsOver = true;
+        } else if (playerDecision == PlayerHitsHand) {
+            dealCardToPlayer();
+            displayPlayerHandContents();
+        } else if (playerDecision == PlayerDoublesDown) {
+            tableSeats.isDoublingDown(indexOfCurrentSeat, indexOfCurrentHand);
+            roundResult.playerBetInChips += tableSeats.getBetInChips(indexOfCurrentSeat, indexOfCurrentHand) / 2; // the bet was doubled
+            if constexpr (PlayerPolicy::displaysTheGame) {
+                playerPolicy.announcePlayerDoublesDown();
+            }
+            dealCardToPlayer(); // The player takes exactly 1 more card (see currentHandWaitsForDecision).
+            displayPlayerHandContents();
+        } else if (playerDecision == PlayerSplitsPair) {
+            tableSeats.isSplitting(indexOfCurrentSeat, indexOfCurrentHand);
+            roundResult.playerBetInChips += tableSeats.getBetInChips(indexOfCurrentSeat, indexOfCurrentHand); // the new hand has an equal bet
+            if constexpr (PlayerPolicy::displaysTheGame) {
+                playerPolicy.announcePlayerSplitsPair();
+            }
+            dealSecondCardToSplitHand();
+            currentHandIsOver = tableSeats.isHandFromSplitAces(indexOfCurrentSeat, indexOfCurrentHand);
+        } else if (playerDecision == PlayerSurrenders) {
+            playerSurrenders();
+        }
+        if (tableSeats.isBusted(indexOfCurrentSeat, indexOfCurrentHand)) {
+            playerLoses();
+        }
+    }
+
+    // The decision is asked for the current hand of the current seat (see
+    // findNextPlayerDecision).
+    int getPlayerHandValue() {
+        return tableSeats.getHandValue(indexOfCurrentSeat, indexOfCurrentHand);
+    }
+
+    bool playerHasSoftHand() {
+        return tableSeats.isSoftHand(indexOfCurrentSeat, indexOfCurrentHand);
+    }
+
+    // Places the cards of the hand waiting for a decision into hand handIndex
+    // of a batch, which evaluates the hands of many games at once.
+    void addPlayerHandToBatch(HandBatch<HouseRules>& handBatch, int handIndex) {
+        handBatch.clearHand(handIndex);
+        for (int cardIndex = 0; cardIndex < tableSeats.getNumberOfCardsInHand(indexOfCurrentSeat, indexOfCurrentHand); cardIndex++) {
+            handBatch.addCardToHand(handIndex, tableSeats.getCardAtPosition(indexOfCurrentSeat, indexOfCurrentHand, cardIndex));
+        }
+    }
+
+    int getDealerUpcardValue() {
+        return dealer.getUpcard().getCardValue();
+    }
+
+    PlayerDecisionOptions getPlayerDecisionOptions() {
+        PlayerDecisionOptions decisionOptions;
+        decisionOptions.canDoubleDown = tableSeats.canDoubleDown(indexOfCurrentSeat, indexOfCurrentHand);
+        decisionOptions.canSplit = tableSeats.canSplit(indexOfCurrentSeat, indexOfCurrentHand);
+        decisionOptions.canSurrender = tableSeats.canSurrender(indexOfCurrentSeat, indexOfCurrentHand);
+        decisionOptions.pairCardValue = tableSeats.getCardAtPosition(indexOfCurrentSeat, indexOfCurrentHand, 0).getCardValue();
+        return decisionOptions;
+    }
+
+    void dealerPlaysHand() {
+        if (playersHaveHandInPlay()) {
+            displayDealerHandContents(); // Reveal the hole card.
+            dealAdditionalCardsToDealer();
+        }
+    }
+
+    void settlePlayerHands() {
+        BLACKJACK_INSTRUMENT_PHASE(SettlementPhase);
+        int playerChipsBeforeShowdown = tableSeats.getCurrentNumberOfChipsToPlay(0); // for the displayed game (of 1 seat)
+        tableSeats.settleBets(numberOfSeats, getDealerHandValue(), dealer.hasNaturalBlackjack());
+        for (indexOfCurrentSeat = 0; indexOfCurrentSeat < numberOfSeats; indexOfCurrentSeat++) {
+            announceSettledHandsOfCurrentPlayer(playerChipsBeforeShowdown);
+            recordRoundResultOfCurrentPlayer();
+        }
+    }
+
+    void roundEnds() {
+        if constexpr (PlayerPolicy::displaysTheGame) {
+            playerPolicy.announceEndOfRound();
+        }
+        if (roundLogWriter != nullptr) {
+            logRound();
+        }
+        discardAllCardsFromTable();
+    }
+};
+
+// Totals of the rounds played, and the sums of the squares and products of
+// the chips wagered and net chips of each round, from which the variance of
+// the results and the confidence interval of the house edge are computed as
+// the rounds stream by. Chips are small integers, so every sum is exact and
+// merging the results of several threads gives the same totals in any order.
+struct SimulationResults {
+    // 95 % of a normal distribution lies within 1.96 standard deviations.
+    static constexpr double normalQuantileOf95PercentConfidence = 1.959963984540054;
+
+    long long roundsPlayed;
+    long long roundsWon;
+    long long roundsPushed;
+    long long roundsLost;
+    long long chipsWagered;
+    long long netChips; // chips won minus chips lost by the player
+    long long sumOfSquaredChipsWagered;
+    long long sumOfSquaredNetChips;
+    long long sumOfNetChipsTimesChipsWagered;
+
+    SimulationResults() {
+        roundsPlayed = 0;
+        roundsWon = 0;
+        roundsPushed = 0;
+        roundsLost = 0;
+        chipsWagered = 0;
+        netChips = 0;
+        sumOfSquaredChipsWagered = 0;
+        sumOfSquaredNetChips = 0;
+        sumOfNetChipsTimesChipsWagered = 0;
+    }
+
+    void addRoundResult(const RoundResult& roundResult) {
+        long long playerBetInChips = roundResult.playerBetInChips;
+        long long playerNetChips = roundResult.playerNetChips;
+        roundsPlayed++;
+        chipsWagered += playerBetInChips;
+        netChips += playerNetChips;
+        sumOfSquaredChipsWagered += playerBetInChips * playerBetInChips;
+        sumOfSquaredNetChips += playerNetChips * playerNetChips;
+        sumOfNetChipsTimesChipsWagered += playerNetChips * playerBetInChips;
+        if (roundResult.roundOutcome == PlayerWinsRound) {
+            roundsWon++;
+        } else if (roundResult.roundOutcome == PlayerPushesRound) {
+            roundsPushed++;
+        } else {
+            roundsLost++;
+        }
+    }
+
+    // Results are integer sums, so merging is exact whatever the order.
+    void addResults(const SimulationResults& otherResults) {
+        roundsPlayed += otherResults.roundsPlayed;
+        roundsWon += otherResults.roundsWon;
+        roundsPushed += otherResults.roundsPushed;
+        roundsLost += otherResults.roundsLost;
+        chipsWagered += otherResults.chipsWagered;
+        netChips += otherResults.netChips;
+        sumOfSquaredChipsWagered += otherResults.sumOfSquaredChipsWagered;
+        sumOfSquaredNetChips += otherResults.sumOfSquaredNetChips;
+        sumOfNetChipsTimesChipsWagered += otherResults.sumOfNetChipsTimesChipsWagered;
+    }
+
+    double computeMeanNetChipsPerRound() const {
+        if (roundsPlayed == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(netChips) / roundsPlayed;
+    }
+
+    // Sample variance of the net chips of a round.
+    double computeVarianceOfNetChips() const {
+        if (roundsPlayed < 2) {
+            return 0.0;
+        }
+        double meanNetChipsPerRound = computeMeanNetChipsPerRound();
+        double sumOfSquaredDeviations = sumOfSquaredNetChips - roundsPlayed * meanNetChipsPerRound * meanNetChipsPerRound;
+        return std::max(0.0, sumOfSquaredDeviations) / (roundsPlayed - 1);
+    }
+
+    // Fraction of the chips wagered that the player loses.
+    double computeHouseEdge() const {
+        if (chipsWagered == 0) {
+            return 0.0;
+        }
+        return -static_cast<double>(netChips) / chipsWagered;
+    }
+
+    // The house edge is a ratio of 2 sums over the rounds (net chips over chips
+    // wagered), whose standard error comes from the variance of the residuals
+    // netChips - ratio * chipsWagered of the rounds (delta method). Infinite
+    // until 2 rounds with a bet are played.
+    double computeStandardErrorOfHouseEdge() const {
+        if (roundsPlayed < 2 || chipsWagered == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double ratio = static_cast<double>(netChips) / chipsWagered;
+        double sumOfSquaredResiduals = sumOfSquaredNetChips - 2.0 * ratio * sumOfNetChipsTimesChipsWagered +
+                                       ratio * ratio * sumOfSquaredChipsWagered;
+        double varianceOfResiduals = std::max(0.0, sumOfSquaredResiduals) / (roundsPlayed - 1);
+        double meanChipsWageredPerRound = static_cast<double>(chipsWagered) / roundsPlayed;
+        return std::sqrt(varianceOfResiduals / roundsPlayed) / meanChipsWageredPerRound;
+    }
+
+    // Half-width of the 95 % confidence interval of the house edge.
+    double computeHouseEdgeMarginOfError() const {
+        return normalQuantileOf95PercentConfidence * computeStandardErrorOfHouseEdge();
+    }
+};
+
+// Streams over a round log mapped into memory, so that the results of
+// billions of logged rounds can be aggregated without loading the file.
+class RoundLogReader {
+private:
+    MemoryMappedFile roundLogFile;
+    long long numberOfRecords;
+
+public:
+    RoundLogReader(const std::string& filePath) : roundLogFile(filePath) {
+        if (roundLogFile.getFileSize() % sizeof(RoundLogRecord) != 0) {
+            throw CustomExceptionWithErrorMessage("Error: '" + filePath + "' is not a round log.");
+        }
+        numberOfRecords = roundLogFile.getFileSize() / sizeof(RoundLogRecord);
+        roundLogFile.adviseSequentialAccess();
+    }
+
+    long long getNumberOfRecords() {
+        return numberOfRecords;
+    }
+
+    // The mapping is page-aligned, so records are properly aligned.
+    const RoundLogRecord& getRecord(long long recordIndex) {
+        return reinterpret_cast<const RoundLogRecord*>(roundLogFile.getFileContents())[recordIndex];
+    }
+
+    SimulationResults aggregateResults() {
+        SimulationResults results;
+        for (long long recordIndex = 0; recordIndex < numberOfRecords; recordIndex++) {
+            const RoundLogRecord& record = getRecord(recordIndex);
+            RoundResult roundResult;
+            roundResult.roundOutcome = static_cast<RoundOutcome>(record.roundOutcome);
+            roundResult.playerBetInChips = record.playerBetInChips;
+            roundResult.playerNetChips = record.playerNetChips;
+            results.addRoundResult(roundResult);
+        }
+        return results;
+    }
+};
+
+// Headless driver of BlackjackGame: plays the same Blackjack rounds with a
+// PlayerPolicy that does not display the game, so that millions of rounds can
+// be simulated for house edge and bankroll analysis.
+template <typename PlayerPolicy, typename RandomNumberGenerator, typename HouseRules = ClassicHouseRules>
+class SimulationEngine {
+private:
+    BlackjackGame<PlayerPolicy, RandomNumberGenerator, HouseRules> blackjackGame;
+    SimulationResults simulationResults;
+
+    static_assert(!PlayerPolicy::displaysTheGame, "A simulation needs a player policy that does not display the game.");
+
+    void topUpPlayerChipsIfNeeded() {
+        for (int seatIndex = 0; seatIndex < blackjackGame.getNumberOfSeats(); seatIndex++) {
+            if (!blackjackGame.playerHasChipsToPlay(seatIndex)) {
+                blackjackGame.playerBuysChips(seatIndex, 100); // The bankroll is topped up so that the simulation can go on.
+            }
+        }
+    }
+
+public:
+    SimulationEngine(int numberOfDecks, double penetration) : SimulationEngine(1, numberOfDecks, penetration) {
+    }
+
+    SimulationEngine(int numberOfSeats, int numberOfDecks, double penetration)
+        : blackjackGame(numberOfSeats, numberOfDecks, penetration) {
+    }
+
+    // The writer is owned by the caller; nullptr stops the logging.
+    void setRoundLogWriter(RoundLogWriter* roundLogWriter) {
+        blackjackGame.setRoundLogWriter(roundLogWriter);
+    }
+
+    // The engine starts afresh (new bankroll, freshly shuffled shoe) on every
+    // call, so the results depend only on the number of rounds and the seed.
+    // Every seat counts as 1 round played in the results.
+    SimulationResults runRounds(long long numberOfRounds, std::uint64_t seed) {
+        blackjackGame.startNewSession(seed);
+        simulationResults = SimulationResults();
+        for (long long roundIndex = 0; roundIndex < numberOfRounds; roundIndex++) {
+            topUpPlayerChipsIfNeeded();
+            blackjackGame.playRound();
+            for (int seatIndex = 0; seatIndex < blackjackGame.getNumberOfSeats(); seatIndex++) {
+                simulationResults.addRoundResult(blackjackGame.getSeatRoundResult(seatIndex));
+            }
+        }
+        return simulationResults;
+    }
+};
+
+// Fixed-size header of a simulation checkpoint file. It describes the
+// simulation (which must match when resuming) and holds the results of the
+// completed chunks; 1 byte per chunk follows it (1 once the chunk is
+// completed). Fields are written in the byte order of the machine.
+struct SimulationCheckpointHeader {
+    static const int maximumLengthOfSimulationName = 47;
+
+    char fileSignature[8];
+    char simulationName[maximumLengthOfSimulationName + 1]; // e.g. "classic basic-strategy xoshiro256"
+    std::uint64_t seed;
+    std::int64_t numberOfRounds;
+    std::int64_t numberOfRoundsPerChunk;
+    std::int32_t numberOfDecks;
+    std::int32_t numberOfSeats;
+    double penetration;
+    double targetHouseEdgeMarginOfError; // 0: every round is played
+    std::int64_t numberOfCompletedChunks;
+    std::int64_t roundsPlayed;
+    std::int64_t roundsWon;
+    std::int64_t roundsPushed;
+    std::int64_t roundsLost;
+    std::int64_t chipsWagered;
+    std::int64_t netChips;
+    std::int64_t sumOfSquaredChipsWagered;
+    std::int64_t sumOfSquaredNetChips;
+    std::int64_t sumOfNetChipsTimesChipsWagered;
+};
+
+static_assert(sizeof(SimulationCheckpointHeader) == 184, "A checkpoint header must stay 184 bytes long.");
+
+// Progress of a ParallelSimulationRunner, so that a long simulation that is
+// stopped can be resumed where it was. Every chunk of rounds starts a fresh
+// session from the seed derived from (seed, chunk index), so its random
+// number generator and shoe never depend on the chunks before it: the
+// checkpoint only records which chunks are completed and the integer sums of
+// their results. A resumed simulation plays the other chunks, and its totals
+// are bit-identical to those of an uninterrupted one (whatever the number of
+// threads of either run).
+// Completed chunks are recorded by the threads of the runner, and the file is
+// rewritten (into a temporary file renamed over it, so that a stopped process
+// never leaves a torn checkpoint) at most once per checkpoint interval. The
+// file is written from a snapshot of the checkpoint, so the threads that
+// complete chunks never wait for the disk.
+class SimulationCheckpoint {
+private:
+    static constexpr char checkpointFileSignature[8] = {'B', 'J', 'C', 'K', 'P', 'T', '0', '1'};
+
+    std::string checkpointFilePath;
+    std::chrono::steady_clock::duration checkpointInterval;
+    std::chrono::steady_clock::time_point lastWriteTime;
+    bool checkpointIsLoaded;
+    SimulationCheckpointHeader checkpointHeader;
+    // A chunk is taken by 1 thread only: its byte is only written by that
+    // thread (holding the mutex), and only read without the mutex by that
+    // thread, before it plays the chunk.
+    std::vector<std::uint8_t> chunkIsCompleted;
+    std::mutex checkpointMutex;
+    // Held while the file is written, before checkpointMutex is taken for the
+    // snapshot: the file is written by 1 thread at a time, from snapshots
+    // taken in order.
+    std::mutex checkpointFileMutex;
+    std::vector<char> checkpointFileBytes; // snapshot of the header and chunk bytes
+
+    void addChunkResults(const SimulationResults& chunkResults) {
+        checkpointHeader.numberOfCompletedChunks++;
+        checkpointHeader.roundsPlayed += chunkResults.roundsPlayed;
+        checkpointHeader.roundsWon += chunkResults.roundsWon;
+        checkpointHeader.roundsPushed += chunkResults.roundsPushed;
+        checkpointHeader.roundsLost += chunkResults.roundsLost;
+        checkpointHeader.chipsWagered += chunkResults.chipsWagered;
+        checkpointHeader.netChips += chunkResults.netChips;
+        checkpointHeader.sumOfSquaredChipsWagered += chunkResults.sumOfSquaredChipsWagered;
+        checkpointHeader.sumOfSquaredNetChips += chunkResults.sumOfSquaredNetChips;
+        checkpointHeader.sumOfNetChipsTimesChipsWagered += chunkResults.sumOfNetChipsTimesChipsWagered;
+    }
+
+    static void writeBytes(int fileDescriptor, const char* bytesToWrite, std::size_t numberOfBytesToWrite, const std::string& filePath) {
+        while (numberOfBytesToWrite > 0) {
+            ssize_t numberOfBytesWritten = write(fileDescriptor, bytesToWrite, numberOfBytesToWrite);
+            if (numberOfBytesWritten <= 0) {
+                close(fileDescriptor);
+                throw CustomExceptionWithErrorMessage("Error: cannot write checkpoint '" + filePath + "'.");
+            }
+            bytesToWrite += numberOfBytesWritten;
+            numberOfBytesToWrite -= numberOfBytesWritten;
+        }
+    }
+
+    // Without it, a crash could lose the rename of the temporary file.
+    void synchronizeDirectoryOfCheckpointFile() {
+        std::string directoryPath = ".";
+        std::size_t indexOfLastSlash = checkpointFilePath.rfind('/');
+        if (indexOfLastSlash == 0) {
+            directoryPath = "/";
+        } else if (indexOfLastSlash != std::string::npos) {
+            directoryPath = checkpointFilePath.substr(0, indexOfLastSlash);
+        }
+        int directoryDescriptor = open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY);
+        if (directoryDescriptor < 0) {
+            throw CustomExceptionWithErrorMessage("Error: cannot open the directory of checkpoint '" + checkpointFilePath + "'.");
+        }
+        if (fsync(directoryDescriptor) != 0) {
+            close(directoryDescriptor);
+            throw CustomExceptionWithErrorMessage("Error: cannot replace checkpoint '" + checkpointFilePath + "'.");
+        }
+        close(directoryDescriptor);
+    }
+
+public:
+    SimulationCheckpoint(const std::string& filePath, int checkpointIntervalInSeconds) {
+        checkpointFilePath = filePath;
+        checkpointInterval = std::chrono::seconds(checkpointIntervalInSeconds);
+        lastWriteTime = std::chrono::steady_clock::now();
+        checkpointIsLoaded = false;
+        checkpointHeader = SimulationCheckpointHeader();
+    }
+
+    SimulationCheckpoint(const SimulationCheckpoint&) = delete;
+    SimulationCheckpoint& operator=(const SimulationCheckpoint&) = delete;
+
+    // Returns false when there is no checkpoint file yet (a new simulation).
+    // The file is mapped into memory, so loading does not copy it twice.
+    bool loadCheckpointFile() {
+        struct stat fileStatus;
+        if (stat(checkpointFilePath.c_str(), &fileStatus) != 0) {
+            return false;
+        }
+        MemoryMappedFile checkpointFile(checkpointFilePath);
+        std::string errorMessage = "Error: '" + checkpointFilePath + "' is not a simulation checkpoint.";
+        if (checkpointFile.getFileSize() < sizeof(SimulationCheckpointHeader)) {
+            throw CustomExceptionWithErrorMessage(errorMessage);
+        }
+        std::memcpy(&checkpointHeader, checkpointFile.getFileContents(), sizeof(SimulationCheckpointHeader));
+        if (std::memcmp(checkpointHeader.fileSignature, checkpointFileSignature, sizeof(checkpointFileSignature)) != 0 ||
+            checkpointHeader.numberOfRounds < 1 || checkpointHeader.numberOfRoundsPerChunk < 1) {
+            throw CustomExceptionWithErrorMessage(errorMessage);
+        }
+        std::int64_t numberOfChunks = (checkpointHeader.numberOfRounds + checkpointHeader.numberOfRoundsPerChunk - 1) /
+                                      checkpointHeader.numberOfRoundsPerChunk;
+        if (checkpointFile.getFileSize() != sizeof(SimulationCheckpointHeader) + numberOfChunks) {
+            throw CustomExceptionWithErrorMessage(errorMessage);
+        }
+        const std::uint8_t* completionBytes = reinterpret_cast<const std::uint8_t*>(checkpointFile.getFileContents() + sizeof(SimulationCheckpointHeader));
+        chunkIsCompleted.assign(completionBytes, completionBytes + numberOfChunks);
+        checkpointHeader.simulationName[SimulationCheckpointHeader::maximumLengthOfSimulationName] = '\0';
+        checkpointIsLoaded = true;
+        return true;
+    }
+
+    std::uint64_t getSeed() {
+        return checkpointHeader.seed;
+    }
+
+    // A loaded checkpoint must describe the very same simulation (the number
+    // of threads may differ); otherwise a new checkpoint is started.
+    void startSimulation(const std::string& simulationName, std::uint64_t seed, long long numberOfRounds,
+                         long long numberOfRoundsPerChunk, int numberOfDecks, int numberOfSeats, double penetration,
+                         double targetHouseEdgeMarginOfError) {
+        if (simulationName.size() > SimulationCheckpointHeader::maximumLengthOfSimulationName) {
+            throw CustomExceptionWithErrorMessage("Error: the name of the simulation is too long for a checkpoint.");
+        }
+        if (checkpointIsLoaded) {
+            if (simulationName != checkpointHeader.simulationName || seed != checkpointHeader.seed ||
+                numberOfRounds != checkpointHeader.numberOfRounds || numberOfRoundsPerChunk != checkpointHeader.numberOfRoundsPerChunk ||
+                numberOfDecks != checkpointHeader.numberOfDecks || numberOfSeats != checkpointHeader.numberOfSeats ||
+                penetration != checkpointHeader.penetration ||
+                targetHouseEdgeMarginOfError != checkpointHeader.targetHouseEdgeMarginOfError) {
+                throw CustomExceptionWithErrorMessage("Error: checkpoint '" + checkpointFilePath + "' was written by a different simulation.");
+            }
+            return;
+        }
+        checkpointHeader = SimulationCheckpointHeader();
+        std::memcpy(checkpointHeader.fileSignature, checkpointFileSignature, sizeof(checkpointFileSignature));
+        std::memcpy(checkpointHeader.simulationName, simulationName.c_str(), simulationName.size() + 1);
+        checkpointHeader.seed = seed;
+        checkpointHeader.numberOfRounds = numberOfRounds;
+        checkpointHeader.numberOfRoundsPerChunk = numberOfRoundsPerChunk;
+        checkpointHeader.numberOfDecks = numberOfDecks;
+        checkpointHeader.numberOfSeats = numberOfSeats;
+        checkpointHeader.penetration = penetration;
+        checkpointHeader.targetHouseEdgeMarginOfError = targetHouseEdgeMarginOfError;
+        chunkIsCompleted.assign((numberOfRounds + numberOfRoundsPerChunk - 1) / numberOfRoundsPerChunk, 0);
+    }
+
+    bool isChunkCompleted(long long chunkIndex) {
+        if (chunkIsCompleted[chunkIndex] != 0) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    // Returns true when the file is due to be rewritten: the caller then
+    // calls writeCheckpointFile, once it holds no lock of its own. Only 1
+    // caller is told so per checkpoint interval.
+    bool completeChunk(long long chunkIndex, const SimulationResults& chunkResults) {
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex);
+        chunkIsCompleted[chunkIndex] = 1;
+        addChunkResults(chunkResults);
+        std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+        if (currentTime - lastWriteTime >= checkpointInterval) {
+            lastWriteTime = currentTime;
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    // Only the snapshot is taken with checkpointMutex held; the file is
+    // written, synchronized and renamed without it.
+    void writeCheckpointFile() {
+        std::lock_guard<std::mutex> checkpointFileLock(checkpointFileMutex);
+        {
+            std::lock_guard<std::mutex> checkpointLock(checkpointMutex);
+            checkpointFileBytes.resize(sizeof(checkpointHeader) + chunkIsCompleted.size());
+            std::memcpy(checkpointFileBytes.data(), &checkpointHeader, sizeof(checkpointHeader));
+            std::memcpy(checkpointFileBytes.data() + sizeof(checkpointHeader), chunkIsCompleted.data(), chunkIsCompleted.size());
+        }
+        std::string temporaryFilePath = checkpointFilePath + ".tmp";
+        int fileDescriptor = open(temporaryFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fileDescriptor < 0) {
+            throw CustomExceptionWithErrorMessage("Error: cannot create checkpoint '" + temporaryFilePath + "'.");
+        }
+        writeBytes(fileDescriptor, checkpointFileBytes.data(), checkpointFileBytes.size(), temporaryFilePath);
+        if (fsync(fileDescriptor) != 0) {
+            close(fileDescriptor);
+            throw CustomExceptionWithErrorMessage("Error: cannot write checkpoint '" + temporaryFilePath + "'.");
+        }
+        close(fileDescriptor);
+        if (std::rename(temporaryFilePath.c_str(), checkpointFilePath.c_str()) != 0) {
+            throw CustomExceptionWithErrorMessage("Error: cannot replace checkpoint '" + checkpointFilePath + "'.");
+        }
+        synchronizeDirectoryOfCheckpointFile();
+    }
+
+    SimulationResults getResultsOfCompletedChunks() {
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex);
+        SimulationResults results;
+        results.roundsPlayed = checkpointHeader.roundsPlayed;
+        results.roundsWon = checkpointHeader.roundsWon;
+        results.roundsPushed = checkpointHeader.roundsPushed;
+        results.roundsLost = checkpointHeader.roundsLost;
+        results.chipsWagered = checkpointHeader.chipsWagered;
+        results.netChips = checkpointHeader.netChips;
+        results.sumOfSquaredChipsWagered = checkpointHeader.sumOfSquaredChipsWagered;
+        results.sumOfSquaredNetChips = checkpointHeader.sumOfSquaredNetChips;
+        results.sumOfNetChipsTimesChipsWagered = checkpointHeader.sumOfNetChipsTimesChipsWagered;
+        return results;
+    }
+
+    long long getNumberOfCompletedChunks() {
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex);
+        return checkpointHeader.numberOfCompletedChunks;
+    }
+};
+
+// Runs a simulation across several threads, each with its own
+// SimulationEngine (and so its own Deck, seats, Dealer and random number
+// generator).
+// The rounds are cut into fixed-size chunks and chunk i is always played with
+// the seed derived from (seed, i), whichever thread plays it. Since the
+// results of each chunk are integer sums, the merged totals for a given seed
+// are bit-identical for any number of threads.
+// Each thread starts with its own contiguous range of chunks; a thread that
+// runs out of work steals the next chunks of the other threads' ranges.
+// With more than 1 seat, each round of the simulation is played by
+// BlackjackGame at a table of that many seats, under any house rules, and
+// every seat counts as 1 round of the results (so N rounds at S seats give
+// N x S rounds played).
+// With a SimulationCheckpoint, the chunks it records as completed are skipped
+// and every chunk completed is recorded into it.
+// With a target margin of error, the simulation stops as soon as the 95 %
+// confidence interval of the house edge is that narrow (see
+// addChunkResultsInOrder), or after all the rounds otherwise.
+template <typename PlayerPolicy, typename RandomNumberGenerator, typename HouseRules = ClassicHouseRules>
+class ParallelSimulationRunner {
+private:
+    static constexpr long long numberOfRoundsPerChunk = 1 << 16;
+
+    struct ChunkRange {
+        std::atomic<long long> nextChunkIndex;
+        long long endChunkIndex;
+    };
+
+    int numberOfThreads;
+    int numberOfDecks;
+    double penetration;
+    RoundLogFile* roundLogFile; // every round is logged, unless nullptr
+    int numberOfSeats;
+    SimulationCheckpoint* simulationCheckpoint; // no checkpoint if nullptr
+    double targetHouseEdgeMarginOfError; // 0: every round is played
+    std::atomic<bool> targetMarginOfErrorIsReached;
+    std::mutex chunkOrderMutex;
+    long long numberOfChunksInOrder;
+    SimulationResults resultsOfChunksInOrder; // of the first numberOfChunksInOrder chunks
+    std::unordered_map<long long, SimulationResults> resultsOfChunksAhead; // completed before an earlier chunk
+
+    // Neighbouring chunks get unrelated seeds (i.e., independent streams).
+    static std::uint64_t computeChunkSeed(std::uint64_t seed, long long chunkIndex) {
+        std::uint64_t splitMixState = seed + 0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(chunkIndex);
+        return nextSplitMix64(splitMixState);
+    }
+
+    bool houseEdgeIsPreciseEnough(const SimulationResults& results) {
+        if (results.computeHouseEdgeMarginOfError() <= targetHouseEdgeMarginOfError) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    // With a target margin of error, the chunks are taken in order from 1
+    // range and added to the results in the order of their indexes, and the
+    // margin of error is checked after each of them. So the simulation stops
+    // after the same chunk whatever the number of threads; the chunks that
+    // other threads complete after it are dropped.
+    // The checkpoint file is written after the chunk order lock is released.
+    void addChunkResultsInOrder(long long chunkIndex, const SimulationResults& chunkResults) {
+        bool checkpointIsDue = false;
+        {
+            std::lock_guard<std::mutex> chunkOrderLock(chunkOrderMutex);
+            resultsOfChunksAhead[chunkIndex] = chunkResults;
+            std::unordered_map<long long, SimulationResults>::iterator nextChunk = resultsOfChunksAhead.find(numberOfChunksInOrder);
+            while (nextChunk != resultsOfChunksAhead.end() && !targetMarginOfErrorIsReached.load(std::memory_order_relaxed)) {
+                resultsOfChunksInOrder.addResults(nextChunk->second);
+                if (simulationCheckpoint != nullptr && simulationCheckpoint->completeChunk(numberOfChunksInOrder, nextChunk->second)) {
+                    checkpointIsDue = true;
+                }
+                resultsOfChunksAhead.erase(nextChunk);
+                numberOfChunksInOrder++;
+                if (houseEdgeIsPreciseEnough(resultsOfChunksInOrder)) {
+                    targetMarginOfErrorIsReached.store(true, std::memory_order_relaxed);
+                }
+                nextChunk = resultsOfChunksAhead.find(numberOfChunksInOrder);
+            }
+        }
+        if (checkpointIsDue) {
+            simulationCheckpoint->writeCheckpointFile();
+        }
+    }
+
+    static bool takeChunk(ChunkRange& chunkRange, long long& chunkIndex) {
+        if (chunkRange.nextChunkIndex.load(std::memory_order_relaxed) >= chunkRange.endChunkIndex) {
+            return false;
+        }
+        chunkIndex = chunkRange.nextChunkIndex.fetch_add(1, std::memory_order_relaxed);
+        return chunkIndex < chunkRange.endChunkIndex;
+    }
+
+    template <typename SimulationEngineType>
+    void runChunks(int threadIndex, SimulationEngineType& simulationEngine, RoundLogWriter* roundLogWriter,
+                   std::vector<ChunkRange>& chunkRanges, long long numberOfRounds, std::uint64_t seed,
+                   SimulationResults& threadResults) {
+        int numberOfRanges = chunkRanges.size();
+        for (int rangeOffset = 0; rangeOffset < numberOfRanges; rangeOffset++) {
+            ChunkRange& chunkRange = chunkRanges[(threadIndex + rangeOffset) % numberOfRanges]; // own range first
+            long long chunkIndex = 0;
+            while (!targetMarginOfErrorIsReached.load(std::memory_order_relaxed) && takeChunk(chunkRange, chunkIndex)) {
+                if (simulationCheckpoint != nullptr && simulationCheckpoint->isChunkCompleted(chunkIndex)) {
+                    continue; // played before the simulation was resumed
+                }
+                long long firstRoundOfChunk = chunkIndex * numberOfRoundsPerChunk;
+                long long numberOfRoundsInChunk = std::min(numberOfRoundsPerChunk, numberOfRounds - firstRoundOfChunk);
+                if (roundLogWriter != nullptr) {
+                    roundLogWriter->moveToRecord(firstRoundOfChunk); // round i is always record i
+                }
+                SimulationResults chunkResults = simulationEngine.runRounds(numberOfRoundsInChunk, computeChunkSeed(seed, chunkIndex));
+                if (targetHouseEdgeMarginOfError > 0.0) {
+                    addChunkResultsInOrder(chunkIndex, chunkResults);
+                    continue;
+                }
+                threadResults.addResults(chunkResults);
+                if (simulationCheckpoint != nullptr && simulationCheckpoint->completeChunk(chunkIndex, chunkResults)) {
+                    simulationCheckpoint->writeCheckpointFile();
+                }
+            }
+        }
+    }
+
+    void runThread(int threadIndex, std::vector<ChunkRange>& chunkRanges, long long numberOfRounds,
+                   std::uint64_t seed, SimulationResults& threadResults) {
+        SimulationEngine<PlayerPolicy, RandomNumberGenerator, HouseRules> simulationEngine(numberOfSeats, numberOfDecks, penetration);
+        std::unique_ptr<RoundLogWriter> roundLogWriter;
+        if (roundLogFile != nullptr) {
+            roundLogWriter.reset(new RoundLogWriter(*roundLogFile, 0));
+            simulationEngine.setRoundLogWriter(roundLogWriter.get());
+        }
+        runChunks(threadIndex, simulationEngine, roundLogWriter.get(), chunkRanges, numberOfRounds, seed, threadResults);
+        if (roundLogWriter) {
+            roundLogWriter->flushRecords();
+        }
+    }
+
+public:
+    ParallelSimulationRunner(int threads, int decks, double shoePenetration) {
+        if (threads < 1) {
+            throw CustomExceptionWithErrorMessage("Error: a simulation needs at least 1 thread.");
+        }
+        numberOfThreads = threads;
+        numberOfDecks = decks;
+        penetration = shoePenetration;
+        roundLogFile = nullptr;
+        numberOfSeats = 1;
+        simulationCheckpoint = nullptr;
+        targetHouseEdgeMarginOfError = 0.0;
+        numberOfChunksInOrder = 0;
+    }
+
+    static long long getNumberOfRoundsPerChunk() {
+        return numberOfRoundsPerChunk;
+    }
+
+    void setNumberOfSeats(int seats) {
+        if (seats < SeatLimits::minimumNumberOfSeats || seats > SeatLimits::maximumNumberOfSeats) {
+            throw CustomExceptionWithErrorMessage("Error: a table must have between 1 and 7 seats.");
+        }
+        numberOfSeats = seats;
+    }
+
+    // The file is owned by the caller; nullptr stops the logging.
+    void setRoundLogFile(RoundLogFile* logFile) {
+        roundLogFile = logFile;
+    }
+
+    // The checkpoint is owned by the caller and must have been started for
+    // this simulation (see SimulationCheckpoint::startSimulation); nullptr
+    // stops the checkpointing.
+    void setCheckpoint(SimulationCheckpoint* checkpoint) {
+        simulationCheckpoint = checkpoint;
+    }
+
+    // Half-width of the 95 % confidence interval of the house edge (as a
+    // fraction of the chips wagered) at which the simulation stops; 0 plays
+    // every round.
+    void setTargetHouseEdgeMarginOfError(double targetMarginOfError) {
+        if (targetMarginOfError < 0.0) {
+            throw CustomExceptionWithErrorMessage("Error: the target margin of error of the house edge cannot be negative.");
+        }
+        targetHouseEdgeMarginOfError = targetMarginOfError;
+    }
+
+    // Throws unless the simulation, as set up so far, can be logged; called
+    // before the round log file is opened, so that a rejected simulation
+    // leaves the file untouched.
+    void checkRoundLogIsAllowed() {
+        if (numberOfSeats > 1) {
+            throw CustomExceptionWithErrorMessage("Error: the round log only records tables of 1 seat.");
+        }
+        if (simulationCheckpoint != nullptr) {
+            throw CustomExceptionWithErrorMessage("Error: the round log cannot be combined with a checkpoint.");
+        }
+        if (targetHouseEdgeMarginOfError > 0.0) {
+            throw CustomExceptionWithErrorMessage("Error: the round log cannot be combined with a target margin of error.");
+        }
+    }
+
+    SimulationResults runRounds(long long numberOfRounds, std::uint64_t seed) {
+        if (roundLogFile != nullptr) {
+            checkRoundLogIsAllowed();
+        }
+        SimulationResults totalResults;
+        numberOfChunksInOrder = 0;
+        if (simulationCheckpoint != nullptr) {
+            totalResults = simulationCheckpoint->getResultsOfCompletedChunks(); // chunks played before resuming
+            numberOfChunksInOrder = simulationCheckpoint->getNumberOfCompletedChunks(); // all first chunks with a target
+        }
+        resultsOfChunksInOrder = totalResults;
+        resultsOfChunksAhead.clear();
+        targetMarginOfErrorIsReached.store(targetHouseEdgeMarginOfError > 0.0 && numberOfChunksInOrder > 0 &&
+                                           houseEdgeIsPreciseEnough(resultsOfChunksInOrder));
+        long long numberOfChunks = (numberOfRounds + numberOfRoundsPerChunk - 1) / numberOfRoundsPerChunk;
+        int numberOfRanges = (targetHouseEdgeMarginOfError > 0.0) ? 1 : numberOfThreads;
+        std::vector<ChunkRange> chunkRanges(numberOfRanges);
+        for (int rangeIndex = 0; rangeIndex < numberOfRanges; rangeIndex++) {
+            chunkRanges[rangeIndex].nextChunkIndex.store(numberOfChunks * rangeIndex / numberOfRanges);
+            chunkRanges[rangeIndex].endChunkIndex = numberOfChunks * (rangeIndex + 1) / numberOfRanges;
+        }
+        std::vector<SimulationResults> resultsPerThread(numberOfThreads);
+        std::vector<std::thread> threads;
+        for (int threadIndex = 1; threadIndex < numberOfThreads; threadIndex++) {
+            threads.push_back(std::thread(&ParallelSimulationRunner::runThread, this, threadIndex, std::ref(chunkRanges),
+                                          numberOfRounds, seed, std::ref(resultsPerThread[threadIndex])));
+        }
+        runThread(0, chunkRanges, numberOfRounds, seed, resultsPerThread[0]); // the calling thread works too
+        for (std::size_t threadIndex = 0; threadIndex < threads.size(); threadIndex++) {
+            threads[threadIndex].join();
+        }
+        for (int threadIndex = 0; threadIndex < numberOfThreads; threadIndex++) {
+            totalResults.addResults(resultsPerThread[threadIndex]);
+        }
+        if (targetHouseEdgeMarginOfError > 0.0) {
+            totalResults = resultsOfChunksInOrder;
+        }
+        if (simulationCheckpoint != nullptr) {
+            simulationCheckpoint->writeCheckpointFile(); // every chunk is completed
+        }
+        return totalResults;
+    }
+};
+
+// States of a ResumableBlackjackTable. The round moves through them in this
+// order; the table only stops (i.e., waits for an event from the player) in
+// WaitingForBet and WaitingForPlayerDecision.
+enum RoundState {
+    WaitingForBet,
+    DealingInitialCards,
+    WaitingForPlayerDecision, // the player's turn
+    DealerTurn,
+    SettlingBet
+};
+
+enum PlayerAction {
+    PlayerPlacesBet,
+    PlayerDecides,
+    PlayerPlaysNewRound, // for CoroutineBlackjackGame only
+    PlayerQuitsGame      // for CoroutineBlackjackGame only
+};
+
+// An action of the player of a table, e.g. received from a client.
+struct PlayerEvent {
+    int tableIndex;
+    PlayerAction playerAction;
+    int betInChips; // for PlayerPlacesBet only
+    PlayerDecision playerDecision; // for PlayerDecides only
+};
+
+// The Blackjack round of BlackjackGame, driven by an explicit state machine
+// so that the table waits for the player's bets and decisions without
+// blocking: handlePlayerEvent runs the phases of the round (see BlackjackGame)
+// up to the next decision of the player and returns.
+template <typename RandomNumberGenerator = Xoshiro256StarStarGenerator, typename HouseRules = ClassicHouseRules>
+class ResumableBlackjackTable {
+private:
+    BlackjackGame<RemotePlayerPolicy, RandomNumberGenerator, HouseRules> blackjackGame;
+    RoundState roundState;
+    long long numberOfRoundsCompleted;
+
+    // The player's turn goes on as long as a hand waits for a decision.
+    RoundState getStateOfPlayerTurn() {
+        if (blackjackGame.findNextPlayerDecision()) {
+            return WaitingForPlayerDecision;
+        } else {
+            return DealerTurn;
+        }
+    }
+
+    // Runs the states that need nothing from the player.
+    void advanceRound() {
+        while (true) {
+            switch (roundState) {
+                case DealingInitialCards:
+                    blackjackGame.dealInitialCards();
+                    roundState = getStateOfPlayerTurn();
+                    break;
+                case DealerTurn:
+                    blackjackGame.dealerPlaysHand();
+                    roundState = SettlingBet;
+                    break;
+                case SettlingBet:
+                    blackjackGame.settlePlayerHands();
+                    blackjackGame.roundEnds();
+                    numberOfRoundsCompleted++;
+                    roundState = WaitingForBet;
+                    break;
+                case WaitingForBet:
+                case WaitingForPlayerDecision:
+                    return;
+            }
+        }
+    }
+
+public:
+    ResumableBlackjackTable(int numberOfDecks, double penetration) : blackjackGame(numberOfDecks, penetration) {
+        roundState = WaitingForBet;
+        numberOfRoundsCompleted = 0;
+    }
+
+    // Like BlackjackGame::startNewSession; only allowed between rounds.
+    void startNewSession(std::uint64_t seed) {
+        if (roundState != WaitingForBet) {
+            throw CustomExceptionWithErrorMessage("Error: a new session cannot start in the middle of a round.");
+        }
+        blackjackGame.startNewSession(seed);
+        numberOfRoundsCompleted = 0;
+    }
+
+    void handlePlayerEvent(const PlayerEvent& playerEvent) {
+        if (roundState == WaitingForBet && playerEvent.playerAction == PlayerPlacesBet) {
+            blackjackGame.startRound();
+            blackjackGame.playerPlacesBet(0, playerEvent.betInChips);
+            roundState = DealingInitialCards;
+        } else if (roundState == WaitingForPlayerDecision && playerEvent.playerAction == PlayerDecides) {
+            blackjackGame.applyPlayerDecision(playerEvent.playerDecision);
+            roundState = getStateOfPlayerTurn();
+        } else {
+            throw CustomExceptionWithErrorMessage("Error: the player's action does not fit the state of the round.");
+        }
+        advanceRound();
+    }
+
+    RoundState getRoundState() {
+        return roundState;
+    }
+
+    // Result of the last completed round.
+    RoundResult getRoundResult() {
+        return blackjackGame.getSeatRoundResult(0);
+    }
+
+    long long getNumberOfRoundsCompleted() {
+        return numberOfRoundsCompleted;
+    }
+
+    int getPlayerHandValue() {
+        return blackjackGame.getPlayerHandValue();
+    }
+
+    bool playerHasSoftHand() {
+        return blackjackGame.playerHasSoftHand();
+    }
+
+    void addPlayerHandToBatch(HandBatch<HouseRules>& handBatch, int handIndex) {
+        blackjackGame.addPlayerHandToBatch(handBatch, handIndex);
+    }
+
+    int getDealerUpcardValue() {
+        return blackjackGame.getDealerUpcardValue();
+    }
+
+    PlayerDecisionOptions getPlayerDecisionOptions() {
+        return blackjackGame.getPlayerDecisionOptions();
+    }
+
+    int getPlayerCurrentNumberOfChipsToPlay() {
+        return blackjackGame.getPlayerCurrentNumberOfChipsToPlay(0);
+    }
+
+    bool playerHasChipsToPlay() {
+        return blackjackGame.playerHasChipsToPlay(0);
+    }
+
+    void playerBuysChips(int newChips) {
+        blackjackGame.playerBuysChips(0, newChips);
+    }
+};
+
+// First-in first-out queue of player events with a fixed capacity (a ring
+// buffer, so queueing never allocates), standing in for a local socket.
+class PlayerEventQueue {
+private:
+    std::vector<PlayerEvent> queuedEvents;
+    std::size_t indexOfFirstEvent;
+    std::size_t numberOfQueuedEvents;
+
+public:
+    PlayerEventQueue(std::size_t capacity) : queuedEvents(std::max<std::size_t>(capacity, 1)) {
+        indexOfFirstEvent = 0;
+        numberOfQueuedEvents = 0;
+    }
+
+    bool isEmpty() {
+        return numberOfQueuedEvents == 0;
+    }
+
+    std::size_t getNumberOfQueuedEvents() {
+        return numberOfQueuedEvents;
+    }
+
+    void pushEvent(const PlayerEvent& playerEvent) {
+        if (numberOfQueuedEvents == queuedEvents.size()) {
+            throw CustomExceptionWithErrorMessage("Error: the queue of player events is full.");
+        }
+        queuedEvents[(indexOfFirstEvent + numberOfQueuedEvents) % queuedEvents.size()] = playerEvent;
+        numberOfQueuedEvents++;
+    }
+
+    PlayerEvent popEvent() {
+        PlayerEvent playerEvent = queuedEvents[indexOfFirstEvent];
+        indexOfFirstEvent = (indexOfFirstEvent + 1) % queuedEvents.size();
+        numberOfQueuedEvents--;
+        return playerEvent;
+    }
+};
+
+// A single-threaded event loop hosting many ResumableBlackjackTables at once.
+// Player events are dispatched in arrival order to their table; no table ever
+// blocks the others while waiting for its player.
+template <typename RandomNumberGenerator = Xoshiro256StarStarGenerator, typename HouseRules = ClassicHouseRules>
+class TableEventLoop {
+private:
+    std::vector<ResumableBlackjackTable<RandomNumberGenerator, HouseRules>> tables;
+    PlayerEventQueue playerEventQueue; // a table waits for at most 1 event at a time
+
+public:
+    TableEventLoop(int numberOfTables, int numberOfDecks, double penetration)
+        : tables(numberOfTables, ResumableBlackjackTable<RandomNumberGenerator, HouseRules>(numberOfDecks, penetration)),
+          playerEventQueue(numberOfTables) {
+        if (numberOfTables < 1) {
+            throw CustomExceptionWithErrorMessage("Error: an event loop needs at least 1 table.");
+        }
+    }
+
+    int getNumberOfTables() {
+        return tables.size();
+    }
+
+    ResumableBlackjackTable<RandomNumberGenerator, HouseRules>& getTable(int tableIndex) {
+        return tables[tableIndex];
+    }
+
+    void postPlayerEvent(const PlayerEvent& playerEvent) {
+        playerEventQueue.pushEvent(playerEvent);
+    }
+
+    int getNumberOfQueuedEvents() {
+        return playerEventQueue.getNumberOfQueuedEvents();
+    }
+
+    // Returns false when there is no event left; otherwise, tableIndex is the
+    // table that handled the event.
+    bool dispatchNextPlayerEvent(int& tableIndex) {
+        if (playerEventQueue.isEmpty()) {
+            return false;
+        }
+        PlayerEvent playerEvent = playerEventQueue.popEvent();
+        tableIndex = playerEvent.tableIndex;
+        tables[tableIndex].handlePlayerEvent(playerEvent);
+        return true;
+    }
+};
+
+// Simulation hosted by a TableEventLoop: the players of all tables are played
+// by the PlayerPolicy, which answers every table as soon as it waits for its
+// player by posting the answer to the event queue (like remote clients would).
+// Rounds are spread evenly over the tables and table i is seeded from
+// (seed, i), so the results do not depend on the order of the events.
+// The tables run in lockstep: each step dispatches the events queued by the
+// previous step, then the hands of all tables waiting for a decision are
+// evaluated at once in a HandBatch (hand i is the hand of table i) before the
+// players are answered.
+template <typename PlayerPolicy, typename RandomNumberGenerator, typename HouseRules = ClassicHouseRules>
+class EventLoopSimulation {
+private:
+    TableEventLoop<RandomNumberGenerator, HouseRules> tableEventLoop;
+    PlayerPolicy playerPolicy;
+    std::vector<long long> numberOfRoundsLeftPerTable;
+    HandBatch<HouseRules> handBatch;
+    std::vector<int> indicesOfTablesOfStep; // the tables that handled an event in the current step
+
+    static_assert(!PlayerPolicy::displaysTheGame, "A simulation needs a player policy that does not display the game.");
+
+    void answerTable(int tableIndex) {
+        ResumableBlackjackTable<RandomNumberGenerator, HouseRules>& table = tableEventLoop.getTable(tableIndex);
+        PlayerEvent playerEvent;
+        playerEvent.tableIndex = tableIndex;
+        playerEvent.betInChips = 0;
+        playerEvent.playerDecision = PlayerStandsOnHand;
+        if (table.getRoundState() == WaitingForPlayerDecision) {
+            playerEvent.playerAction = PlayerDecides;
+            playerEvent.playerDecision = playerPolicy.askPlayerForDecision(handBatch.getHandValue(tableIndex), handBatch.isSoftHand(tableIndex),
+                                                                           table.getDealerUpcardValue(), table.getPlayerDecisionOptions());
+        } else {
+            if (numberOfRoundsLeftPerTable[tableIndex] == 0) {
+                return; // The table is done.
+            }
+            numberOfRoundsLeftPerTable[tableIndex]--;
+            if (!table.playerHasChipsToPlay()) {
+                table.playerBuysChips(100); // The bankroll is topped up so that the simulation can go on.
+            }
+            playerEvent.playerAction = PlayerPlacesBet;
+            playerEvent.betInChips = playerPolicy.askPlayerToBetChips(HouseRules::minimumBet, table.getPlayerCurrentNumberOfChipsToPlay());
+        }
+        tableEventLoop.postPlayerEvent(playerEvent);
+    }
+
+    // Dispatches the events queued by the previous step, evaluates the hands
+    // waiting for a decision and answers the tables (which queues the events
+    // of the next step).
+    void runStep(SimulationResults& simulationResults) {
+        int numberOfEventsOfStep = tableEventLoop.getNumberOfQueuedEvents();
+        indicesOfTablesOfStep.clear();
+        for (int eventIndex = 0; eventIndex < numberOfEventsOfStep; eventIndex++) {
+            int tableIndex = 0;
+            tableEventLoop.dispatchNextPlayerEvent(tableIndex);
+            ResumableBlackjackTable<RandomNumberGenerator, HouseRules>& table = tableEventLoop.getTable(tableIndex);
+            if (table.getRoundState() == WaitingForBet) {
+                simulationResults.addRoundResult(table.getRoundResult()); // The round is over.
+            } else {
+                table.addPlayerHandToBatch(handBatch, tableIndex);
+            }
+            indicesOfTablesOfStep.push_back(tableIndex);
+        }
+        handBatch.evaluateHands();
+        for (std::size_t stepIndex = 0; stepIndex < indicesOfTablesOfStep.size(); stepIndex++) {
+            answerTable(indicesOfTablesOfStep[stepIndex]);
+        }
+    }
+
+public:
+    EventLoopSimulation(int numberOfTables, int numberOfDecks, double penetration)
+        : tableEventLoop(numberOfTables, numberOfDecks, penetration), numberOfRoundsLeftPerTable(numberOfTables),
+          handBatch(numberOfTables) {
+        indicesOfTablesOfStep.reserve(numberOfTables);
+    }
+
+    SimulationResults runRounds(long long numberOfRounds, std::uint64_t seed) {
+        int numberOfTables = tableEventLoop.getNumberOfTables();
+        for (int tableIndex = 0; tableIndex < numberOfTables; tableIndex++) {
+            std::uint64_t splitMixState = seed + 0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(tableIndex);
+            tableEventLoop.getTable(tableIndex).startNewSession(nextSplitMix64(splitMixState));
+            numberOfRoundsLeftPerTable[tableIndex] = numberOfRounds / numberOfTables + (tableIndex < numberOfRounds % numberOfTables);
+            answerTable(tableIndex);
+        }
+        SimulationResults simulationResults;
+        while (tableEventLoop.getNumberOfQueuedEvents() > 0) {
+            runStep(simulationResults);
+        }
+        return simulationResults;
+    }
+};
+
+// Recycles the frames of the coroutines of a thread (see GameTask): a frame
+// that is freed goes onto a free list and is reused by the next coroutine, and
+// new frames are carved out of large slabs, so thousands of suspended games
+// cost a few hundred bytes each and no heap allocation once the pool is warm.
+class CoroutineFramePool {
+private:
+    static const std::size_t frameBlockSize = 256; // larger frames come from the heap
+    static const int numberOfFramesPerSlab = 1024;
+
+    struct FreeFrame {
+        FreeFrame* nextFreeFrame;
+    };
+
+    FreeFrame* firstFreeFrame;
+    std::vector<std::unique_ptr<unsigned char[]>> slabs;
+    long long numberOfFramesInUse;
+
+    void addSlab() {
+        slabs.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[frameBlockSize * numberOfFramesPerSlab]));
+        unsigned char* slab = slabs.back().get();
+        for (int frameIndex = numberOfFramesPerSlab - 1; frameIndex >= 0; frameIndex--) {
+            FreeFrame* freeFrame = reinterpret_cast<FreeFrame*>(slab + frameIndex * frameBlockSize);
+            freeFrame->nextFreeFrame = firstFreeFrame;
+            firstFreeFrame = freeFrame;
+        }
+    }
+
+public:
+    CoroutineFramePool() {
+        firstFreeFrame = nullptr;
+        numberOfFramesInUse = 0;
+    }
+
+    CoroutineFramePool(const CoroutineFramePool&) = delete;
+    CoroutineFramePool& operator=(const CoroutineFramePool&) = delete;
+
+    static CoroutineFramePool& getThreadPool() {
+        thread_local CoroutineFramePool threadPool;
+        return threadPool;
+    }
+
+    void* allocateFrame(std::size_t frameSize) {
+        if (frameSize > frameBlockSize) {
+            return ::operator new(frameSize);
+        }
+        if (firstFreeFrame == nullptr) {
+            addSlab();
+        }
+        FreeFrame* frame = firstFreeFrame;
+        firstFreeFrame = frame->nextFreeFrame;
+        numberOfFramesInUse++;
+        return frame;
+    }
+
+    void freeFrame(void* frame, std::size_t frameSize) {
+        if (frameSize > frameBlockSize) {
+            ::operator delete(frame);
+            return;
+        }
+        FreeFrame* freeFrame = static_cast<FreeFrame*>(frame);
+        freeFrame->nextFreeFrame = firstFreeFrame;
+        firstFreeFrame = freeFrame;
+        numberOfFramesInUse--;
+    }
+
+    long long getNumberOfFramesInUse() {
+        return numberOfFramesInUse;
+    }
+
+    std::size_t getFrameBlockSize() {
+        return frameBlockSize;
+    }
+};
+
+// Coroutine of the game flow (see CoroutineBlackjackGame). A task starts
+// suspended; it is either started by its owner or awaited by another task,
+// which is resumed once the task is over. An exception thrown by the task is
+// rethrown to whoever awaits it (or by rethrowIfFailed).
+class GameTask {
+public:
+    struct promise_type {
+        std::coroutine_handle<> awaitingCoroutine;
+        std::exception_ptr thrownException;
+
+        static void* operator new(std::size_t frameSize) {
+            return CoroutineFramePool::getThreadPool().allocateFrame(frameSize);
+        }
+
+        static void operator delete(void* frame, std::size_t frameSize) {
+            CoroutineFramePool::getThreadPool().freeFrame(frame, frameSize);
+        }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> finishedCoroutine) noexcept {
+                std::coroutine_handle<> awaitingCoroutine = finishedCoroutine.promise().awaitingCoroutine;
+                if (awaitingCoroutine) {
+                    return awaitingCoroutine;
+                } else {
+                    return std::noop_coroutine();
+                }
+            }
+
+            void await_resume() noexcept {
+            }
+        };
+
+        GameTask get_return_object() {
+            return GameTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return std::suspend_always();
+        }
+
+        FinalAwaiter final_suspend() noexcept {
+            return FinalAwaiter();
+        }
+
+        void return_void() {
+        }
+
+        void unhandled_exception() {
+            thrownException = std::current_exception();
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> coroutineHandle;
+
+    explicit GameTask(std::coroutine_handle<promise_type> handle) {
+        coroutineHandle = handle;
+    }
+
+public:
+    GameTask() {
+        coroutineHandle = nullptr;
+    }
+
+    GameTask(GameTask&& otherTask) noexcept {
+        coroutineHandle = otherTask.coroutineHandle;
+        otherTask.coroutineHandle = nullptr;
+    }
+
+    GameTask& operator=(GameTask&& otherTask) noexcept {
+        if (this != &otherTask) {
+            if (coroutineHandle) {
+                coroutineHandle.destroy();
+            }
+            coroutineHandle = otherTask.coroutineHandle;
+            otherTask.coroutineHandle = nullptr;
+        }
+        return *this;
+    }
+
+    ~GameTask() {
+        if (coroutineHandle) {
+            coroutineHandle.destroy();
+        }
+    }
+
+    void start() {
+        coroutineHandle.resume();
+    }
+
+    bool isDone() {
+        return !coroutineHandle || coroutineHandle.done();
+    }
+
+    void rethrowIfFailed() {
+        if (coroutineHandle && coroutineHandle.promise().thrownException) {
+            std::rethrow_exception(coroutineHandle.promise().thrownException);
+        }
+    }
+
+    // co_await on a task runs it until it is over.
+    bool await_ready() {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaitingCoroutine) {
+        coroutineHandle.promise().awaitingCoroutine = awaitingCoroutine;
+        return coroutineHandle;
+    }
+
+    void await_resume() {
+        rethrowIfFailed();
+    }
+};
+
+enum PlayerQuestion {
+    NoQuestion,
+    AskingPlayerToBet,
+    AskingPlayerForDecision,
+    AskingPlayerToPlayNewRound
+};
+
+// The game of BlackjackGame written as coroutines: beginPlaying and
+// roundStarts run the same game and the phases of the same round (see
+// BlackjackGame), but co_await the bets and decisions of the player instead
+// of calling a blocking policy. While the game waits for an answer,
+// getPendingQuestion tells the question; answerPendingQuestion resumes the
+// game up to the next question (or the end of the game).
+// The coroutines keep a pointer to the game, which must not move once started.
+template <typename RandomNumberGenerator = Xoshiro256StarStarGenerator, typename HouseRules = ClassicHouseRules>
+class CoroutineBlackjackGame {
+private:
+    BlackjackGame<RemotePlayerPolicy, RandomNumberGenerator, HouseRules> blackjackGame;
+    GameTask gameTask;
+    PlayerQuestion pendingQuestion;
+    std::coroutine_handle<> coroutineWaitingForAnswer;
+    int playerAnswer; // chips to bet, a PlayerDecision, or 1 for yes and 0 for no
+    long long numberOfRoundsCompleted;
+
+    // co_await askPlayer(question) suspends the game until the player answers.
+    struct PlayerAnswerAwaiter {
+        CoroutineBlackjackGame& coroutineGame;
+        PlayerQuestion playerQuestion;
+
+        bool await_ready() {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> waitingCoroutine) {
+            coroutineGame.pendingQuestion = playerQuestion;
+            coroutineGame.coroutineWaitingForAnswer = waitingCoroutine;
+        }
+
+        int await_resume() {
+            return coroutineGame.playerAnswer;
+        }
+    };
+
+    PlayerAnswerAwaiter askPlayer(PlayerQuestion playerQuestion) {
+        return PlayerAnswerAwaiter{*this, playerQuestion};
+    }
+
+    GameTask beginPlaying() {
+        // A Blackjack game consists of 1 or more rounds.
+        if (!blackjackGame.playerHasChipsToPlay(0)) {
+            co_return;
+        }
+        bool playerWantsNewRound = true; // co_await is kept out of the loop condition, which GCC 12 miscompiles
+        do {
+            co_await roundStarts();
+            roundEnds();
+            if (!blackjackGame.playerHasChipsToPlay(0)) {
+                co_return;
             }
-        } while (askPlayerToPlayNewRound() == true);
-        gameEnds();
-        return;
+            playerWantsNewRound = co_await askPlayer(AskingPlayerToPlayNewRound) == 1;
+        } while (playerWantsNewRound);
+    }
+
+    // See the algorithm for a Blackjack round in BlackjackGame.
+    GameTask roundStarts() {
+        blackjackGame.startRound();
+        int playerBetInChips = co_await askPlayer(AskingPlayerToBet);
+        blackjackGame.playerPlacesBet(0, playerBetInChips);
+        blackjackGame.dealInitialCards();
+        while (blackjackGame.findNextPlayerDecision()) {
+            PlayerDecision playerDecision = static_cast<PlayerDecision>(co_await askPlayer(AskingPlayerForDecision));
+            blackjackGame.applyPlayerDecision(playerDecision);
+        }
+        blackjackGame.dealerPlaysHand();
+        blackjackGame.settlePlayerHands();
+    }
+
+    void roundEnds() {
+        blackjackGame.roundEnds();
+        numberOfRoundsCompleted++;
+    }
+
+public:
+    CoroutineBlackjackGame(int numberOfDecks, double penetration) : blackjackGame(numberOfDecks, penetration) {
+        pendingQuestion = NoQuestion;
+        coroutineWaitingForAnswer = nullptr;
+        playerAnswer = 0;
+        numberOfRoundsCompleted = 0;
+    }
+
+    CoroutineBlackjackGame(const CoroutineBlackjackGame&) = delete;
+    CoroutineBlackjackGame& operator=(const CoroutineBlackjackGame&) = delete;
+
+    // Like BlackjackGame::startNewSession.
+    void startNewSession(std::uint64_t seed) {
+        blackjackGame.startNewSession(seed);
+    }
+
+    // Runs a new game up to the first question to the player.
+    void startGame() {
+        if (!gameTask.isDone()) {
+            throw CustomExceptionWithErrorMessage("Error: the game has already started.");
+        }
+        gameTask = beginPlaying();
+        gameTask.start();
+        gameTask.rethrowIfFailed();
+    }
+
+    bool isGameOver() {
+        return gameTask.isDone();
+    }
+
+    PlayerQuestion getPendingQuestion() {
+        return pendingQuestion;
+    }
+
+    void answerPendingQuestion(int answer) {
+        if (pendingQuestion == NoQuestion) {
+            throw CustomExceptionWithErrorMessage("Error: the game is not waiting for the player.");
+        }
+        pendingQuestion = NoQuestion;
+        playerAnswer = answer;
+        std::coroutine_handle<> waitingCoroutine = coroutineWaitingForAnswer;
+        coroutineWaitingForAnswer = nullptr;
+        waitingCoroutine.resume();
+        gameTask.rethrowIfFailed();
+    }
+
+    // Result of the last completed round.
+    RoundResult getRoundResult() {
+        return blackjackGame.getSeatRoundResult(0);
+    }
+
+    long long getNumberOfRoundsCompleted() {
+        return numberOfRoundsCompleted;
+    }
+
+    int getPlayerHandValue() {
+        return blackjackGame.getPlayerHandValue();
+    }
+
+    bool playerHasSoftHand() {
+        return blackjackGame.playerHasSoftHand();
+    }
+
+    int getDealerUpcardValue() {
+        return blackjackGame.getDealerUpcardValue();
+    }
+
+    PlayerDecisionOptions getPlayerDecisionOptions() {
+        return blackjackGame.getPlayerDecisionOptions();
+    }
+
+    int getPlayerCurrentNumberOfChipsToPlay() {
+        return blackjackGame.getPlayerCurrentNumberOfChipsToPlay(0);
+    }
+
+    void playerBuysChips(int newChips) {
+        blackjackGame.playerBuysChips(0, newChips);
+    }
+};
+
+// Like EventLoopSimulation, with CoroutineBlackjackGames instead of
+// ResumableBlackjackTables: the answers of the PlayerPolicy are queued as
+// PlayerEvents, and dispatching an event resumes the coroutine of its game.
+// A game whose player runs out of chips is over; its player then buys chips
+// and a new game starts on the same shoe.
+template <typename PlayerPolicy, typename RandomNumberGenerator, typename HouseRules = ClassicHouseRules>
+class CoroutineGameSimulation {
+private:
+    std::vector<std::unique_ptr<CoroutineBlackjackGame<RandomNumberGenerator, HouseRules>>> blackjackGames; // games never move
+    PlayerEventQueue playerEventQueue;
+    PlayerPolicy playerPolicy;
+    std::vector<long long> numberOfRoundsLeftPerGame;
+
+    static_assert(!PlayerPolicy::displaysTheGame, "A simulation needs a player policy that does not display the game.");
+
+    void answerGame(int gameIndex) {
+        CoroutineBlackjackGame<RandomNumberGenerator, HouseRules>& blackjackGame = *blackjackGames[gameIndex];
+        if (blackjackGame.isGameOver()) {
+            if (numberOfRoundsLeftPerGame[gameIndex] == 0) {
+                return; // The game is done.
+            }
+            numberOfRoundsLeftPerGame[gameIndex]--;
+            blackjackGame.playerBuysChips(100); // The bankroll is topped up so that the simulation can go on.
+            blackjackGame.startGame();
+        }
+        PlayerEvent playerEvent;
+        playerEvent.tableIndex = gameIndex;
+        playerEvent.betInChips = 0;
+        playerEvent.playerDecision = PlayerStandsOnHand;
+        PlayerQuestion pendingQuestion = blackjackGame.getPendingQuestion();
+        if (pendingQuestion == AskingPlayerToBet) {
+            playerEvent.playerAction = PlayerPlacesBet;
+            playerEvent.betInChips = playerPolicy.askPlayerToBetChips(HouseRules::minimumBet, blackjackGame.getPlayerCurrentNumberOfChipsToPlay());
+        } else if (pendingQuestion == AskingPlayerForDecision) {
+            playerEvent.playerAction = PlayerDecides;
+            playerEvent.playerDecision = playerPolicy.askPlayerForDecision(blackjackGame.getPlayerHandValue(), blackjackGame.playerHasSoftHand(),
+                                                                           blackjackGame.getDealerUpcardValue(), blackjackGame.getPlayerDecisionOptions());
+        } else {
+            bool playerPlaysNewRound = numberOfRoundsLeftPerGame[gameIndex] > 0;
+            if (playerPlaysNewRound) {
+                numberOfRoundsLeftPerGame[gameIndex]--;
+            }
+            playerEvent.playerAction = playerPlaysNewRound ? PlayerPlaysNewRound : PlayerQuitsGame;
+        }
+        playerEventQueue.pushEvent(playerEvent);
+    }
+
+    static int getAnswerToQuestion(const PlayerEvent& playerEvent) {
+        if (playerEvent.playerAction == PlayerPlacesBet) {
+            return playerEvent.betInChips;
+        } else if (playerEvent.playerAction == PlayerDecides) {
+            return playerEvent.playerDecision;
+        } else if (playerEvent.playerAction == PlayerPlaysNewRound) {
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+
+public:
+    CoroutineGameSimulation(int numberOfGames, int numberOfDecks, double penetration)
+        : playerEventQueue(numberOfGames), numberOfRoundsLeftPerGame(numberOfGames) {
+        if (numberOfGames < 1) {
+            throw CustomExceptionWithErrorMessage("Error: a simulation needs at least 1 game.");
+        }
+        for (int gameIndex = 0; gameIndex < numberOfGames; gameIndex++) {
+            blackjackGames.push_back(std::unique_ptr<CoroutineBlackjackGame<RandomNumberGenerator, HouseRules>>(
+                new CoroutineBlackjackGame<RandomNumberGenerator, HouseRules>(numberOfDecks, penetration)));
+        }
+    }
+
+    SimulationResults runRounds(long long numberOfRounds, std::uint64_t seed) {
+        int numberOfGames = blackjackGames.size();
+        for (int gameIndex = 0; gameIndex < numberOfGames; gameIndex++) {
+            std::uint64_t splitMixState = seed + 0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(gameIndex);
+            blackjackGames[gameIndex]->startNewSession(nextSplitMix64(splitMixState));
+            numberOfRoundsLeftPerGame[gameIndex] = numberOfRounds / numberOfGames + (gameIndex < numberOfRounds % numberOfGames);
+            if (numberOfRoundsLeftPerGame[gameIndex] > 0) {
+                numberOfRoundsLeftPerGame[gameIndex]--; // A new game starts with a round.
+                blackjackGames[gameIndex]->startGame();
+                answerGame(gameIndex);
+            }
+        }
+        SimulationResults simulationResults;
+        while (!playerEventQueue.isEmpty()) {
+            PlayerEvent playerEvent = playerEventQueue.popEvent();
+            CoroutineBlackjackGame<RandomNumberGenerator, HouseRules>& blackjackGame = *blackjackGames[playerEvent.tableIndex];
+            long long numberOfRoundsCompletedBefore = blackjackGame.getNumberOfRoundsCompleted();
+            blackjackGame.answerPendingQuestion(getAnswerToQuestion(playerEvent));
+            if (blackjackGame.getNumberOfRoundsCompleted() > numberOfRoundsCompletedBefore) {
+                simulationResults.addRoundResult(blackjackGame.getRoundResult());
+            }
+            answerGame(playerEvent.tableIndex);
+        }
+        return simulationResults;
+    }
+};
+
+class SimulationPresenter {
+public:
+    void displayDealerOutcomeProbabilitiesHeader(const char* rulesName, int numberOfDecks) {
+        std::cout << "Dealer's final hand probabilities (" << rulesName << " rules, " << numberOfDecks
+                  << " deck(s), upcard removed from the shoe):" << "\n";
+        std::cout << "Upcard      17       18       19       20       21     Bust" << "\n";
+    }
+
+    void displayDealerOutcomeProbabilities(int upcardValue, const DealerOutcomeProbabilities& outcomes) {
+        std::string upcardInText = (upcardValue == 1) ? "Ace" : std::to_string(upcardValue);
+        std::printf("%-6s", upcardInText.c_str());
+        for (int dealerHandValue = 17; dealerHandValue <= 21; dealerHandValue++) {
+            std::printf(" %8.5f", outcomes.getProbabilityOfFinalHandValue(dealerHandValue));
+        }
+        std::printf(" %8.5f\n", outcomes.probabilityOfBust);
+    }
+
+    void displaySimulationSettings(long long numberOfRounds, const char* rulesName, int numberOfDecks, int numberOfSeats,
+                                   int numberOfThreads, std::uint64_t seed) {
+        std::cout << "Simulating " << numberOfRounds << " rounds of the " << rulesName << " rules (" << numberOfDecks
+                  << " deck(s)) at a table of " << numberOfSeats << " seat(s) on " << numberOfThreads << " thread(s) with seed "
+                  << seed << "." << "\n";
+        if (numberOfSeats > 1) {
+            std::cout << "Each seat counts as 1 round: " << numberOfRounds * numberOfSeats << " rounds are played in all." << "\n";
+        }
+    }
+
+    void displayEventLoopSettings(long long numberOfRounds, int numberOfTables, bool useCoroutines, std::uint64_t seed) {
+        std::cout << "Simulating " << numberOfRounds << " rounds at " << numberOfTables << " table(s) hosted by 1 event loop"
+                  << (useCoroutines ? " of coroutines" : "") << " with seed " << seed << "." << "\n";
+    }
+
+    void displayTargetMarginOfError(double targetHouseEdgeMarginOfError, long long maximumNumberOfRounds) {
+        std::cout << "Stopping once the house edge is known within +/- " << 100.0 * targetHouseEdgeMarginOfError
+                  << " % (95 % confidence), or after " << maximumNumberOfRounds << " rounds." << "\n";
+    }
+
+    void displayCheckpointResumption(const std::string& checkpointFilePath, long long roundsPlayedBeforeResuming) {
+        std::cout << "Resuming from checkpoint '" << checkpointFilePath << "': " << roundsPlayedBeforeResuming
+                  << " rounds already played." << "\n";
+    }
+
+    void displayRoundLogSettings(const std::string& roundLogFilePath, long long numberOfRecords) {
+        std::cout << "Reading " << numberOfRecords << " rounds from round log '" << roundLogFilePath << "'." << "\n";
+    }
+
+    // The house edge per chip wagered is what --simulate reports.
+    void displayHouseEdgeAnalysis(const char* rulesName, int numberOfDecks, int numberOfThreads,
+                                  const HouseEdgeAnalysis& analysis, double elapsedSeconds) {
+        std::cout << "Exact house edge of the " << rulesName << " rules (" << numberOfDecks
+                  << " deck(s), full shoe every round) on " << numberOfThreads << " thread(s):" << "\n";
+        std::printf("Expected net chips per initial bet:  %.8f\n", analysis.expectedNetChipsPerInitialBet);
+        std::printf("Chips wagered per initial bet:       %.8f\n", analysis.expectedChipsWageredPerInitialBet);
+        std::printf("House edge per initial bet:          %.6f %%\n", -100.0 * analysis.expectedNetChipsPerInitialBet);
+        std::printf("House edge per chip wagered:         %.6f %%\n",
+                    -100.0 * analysis.expectedNetChipsPerInitialBet / analysis.expectedChipsWageredPerInitialBet);
+        std::cout << "Memoized compositions:               " << analysis.numberOfMemoizedCompositions << "\n";
+        std::cout << "Elapsed time:                        " << elapsedSeconds << " s" << std::endl;
+    }
+
+    // Rounds played before a simulation was resumed do not count in the rate.
+    void displaySimulationResults(const SimulationResults& results, double elapsedSeconds, long long roundsPlayedBeforeResuming) {
+        double roundsPerSecond = 0.0;
+        if (elapsedSeconds > 0.0) {
+            roundsPerSecond = (results.roundsPlayed - roundsPlayedBeforeResuming) / elapsedSeconds;
+        }
+        double percentOfRounds = 0.0;
+        if (results.roundsPlayed > 0) {
+            percentOfRounds = 100.0 / results.roundsPlayed;
+        }
+        double houseEdge = 100.0 * results.computeHouseEdge();
+        std::cout << "Rounds played:  " << results.roundsPlayed << "\n";
+        std::cout << "Player wins:    " << results.roundsWon << " (" << results.roundsWon * percentOfRounds << " %)\n";
+        std::cout << "Player pushes:  " << results.roundsPushed << " (" << results.roundsPushed * percentOfRounds << " %)\n";
+        std::cout << "Player losses:  " << results.roundsLost << " (" << results.roundsLost * percentOfRounds << " %)\n";
+        std::cout << "Chips wagered:  " << results.chipsWagered << "\n";
+        std::cout << "Net chips:      " << results.netChips << " (per round: mean " << results.computeMeanNetChipsPerRound()
+                  << ", standard deviation " << std::sqrt(results.computeVarianceOfNetChips()) << ")\n";
+        std::cout << "House edge:     " << houseEdge << " %";
+        if (results.roundsPlayed >= 2 && results.chipsWagered > 0) {
+            double houseEdgeMarginOfError = 100.0 * results.computeHouseEdgeMarginOfError();
+            std::cout << " (95 % confidence interval: " << houseEdge - houseEdgeMarginOfError << " % to "
+                      << houseEdge + houseEdgeMarginOfError << " %)";
+        }
+        std::cout << "\n";
+        std::cout << "Elapsed time:   " << elapsedSeconds << " s\n";
+        std::cout << "Rounds/sec:     " << roundsPerSecond << std::endl;
+    }
+};
+
+struct BenchmarkResult {
+    std::string benchmarkName;
+    long long numberOfOperations;
+    double nanosecondsPerOperation;
+    double heapAllocationsPerOperation;
+};
+
+// Keeps the compiler from optimizing away a benchmarked computation.
+template <typename BenchmarkedValue>
+inline void keepBenchmarkedValue(const BenchmarkedValue& benchmarkedValue) {
+    asm volatile("" : : "r,m"(benchmarkedValue) : "memory");
+}
+
+// Micro-benchmarks of the building blocks of a round, and a macro-benchmark
+// of full headless rounds.
+class BenchmarkSuite {
+private:
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    std::vector<BenchmarkResult> benchmarkResults;
+    Xoshiro256StarStarGenerator randomNumberGenerator;
+    int numberOfDecks;
+
+    void addBenchmarkResult(const std::string& benchmarkName, long long numberOfOperations,
+                            BenchmarkClock::duration elapsedTime, long long heapAllocations) {
+        BenchmarkResult benchmarkResult;
+        benchmarkResult.benchmarkName = benchmarkName;
+        benchmarkResult.numberOfOperations = numberOfOperations;
+        benchmarkResult.nanosecondsPerOperation =
+            std::chrono::duration<double, std::nano>(elapsedTime).count() / numberOfOperations;
+        benchmarkResult.heapAllocationsPerOperation = static_cast<double>(heapAllocations) / numberOfOperations;
+        benchmarkResults.push_back(benchmarkResult);
+    }
+
+    void benchmarkCreateOrderedDeck(long long numberOfOperations) {
+        Deck deck(numberOfDecks, 0.0);
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex++) {
+            deck.createOrderedDeck();
+            keepBenchmarkedValue(deck);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Deck::createOrderedDeck", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    void benchmarkShuffleDeck(long long numberOfOperations) {
+        Deck deck(numberOfDecks, 0.0);
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex++) {
+            deck.shuffleDeck(randomNumberGenerator);
+            keepBenchmarkedValue(deck);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Deck::shuffleDeck", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    // The shoe is emptied card by card; putting the cards back is not timed.
+    void benchmarkDrawCardFromDeck(long long numberOfOperations) {
+        Deck deck(numberOfDecks, 0.0);
+        long long numberOfCardsDrawn = 0;
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::duration::zero();
+        while (numberOfCardsDrawn < numberOfOperations) {
+            deck.reshuffleShoe(randomNumberGenerator);
+            BenchmarkClock::time_point startTime = BenchmarkClock::now();
+            while (!deck.isDeckEmpty()) {
+                Card drawnCard = deck.drawCardfromDeck();
+                keepBenchmarkedValue(drawnCard);
+                numberOfCardsDrawn++;
+            }
+            elapsedTime += BenchmarkClock::now() - startTime;
+        }
+        addBenchmarkResult("Deck::drawCardfromDeck", numberOfCardsDrawn, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    void benchmarkGetTrueCount(long long numberOfOperations) {
+        Deck deck(numberOfDecks, 0.0);
+        deck.reshuffleShoe(randomNumberGenerator);
+        for (int cardIndex = 0; cardIndex < 20; cardIndex++) {
+            deck.drawCardfromDeck();
+        }
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex++) {
+            keepBenchmarkedValue(deck);
+            double trueCount = deck.getTrueCount();
+            keepBenchmarkedValue(trueCount);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Deck::getTrueCount", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    void benchmarkGetHandValue(long long numberOfOperations) {
+        Hand hand;
+        hand.addCardToHand(Card(Ace, Spades));
+        hand.addCardToHand(Card(Six, Hearts));
+        hand.addCardToHand(Card(Four, Clubs));
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex++) {
+            keepBenchmarkedValue(hand);
+            int handValue = hand.getHandValue();
+            keepBenchmarkedValue(handValue);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Hand::getHandValue", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    // Operations are cards added; the hand is cleared every 4 cards (Ace, 6,
+    // 4 and King: a soft, a hard and a busted hand value on the way).
+    void benchmarkAddCardToHand(long long numberOfOperations) {
+        Card cardsToAdd[4] = {Card(Ace, Spades), Card(Six, Hearts), Card(Four, Clubs), Card(King, Diamonds)};
+        Hand hand;
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex += 4) {
+            hand.clearHand();
+            for (int cardIndex = 0; cardIndex < 4; cardIndex++) {
+                keepBenchmarkedValue(cardsToAdd[cardIndex]);
+                hand.addCardToHand(cardsToAdd[cardIndex]);
+            }
+            keepBenchmarkedValue(hand);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Hand::addCardToHand", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    // Operations are hands evaluated.
+    void benchmarkEvaluateHandBatch(long long numberOfOperations) {
+        const int numberOfHands = 4096;
+        HandBatch<ClassicHouseRules> handBatch(numberOfHands);
+        std::vector<std::uint8_t> cardValues(numberOfHands);
+        for (int cardsPerHand = 0; cardsPerHand < 3; cardsPerHand++) {
+            for (int handIndex = 0; handIndex < numberOfHands; handIndex++) {
+                cardValues[handIndex] = 1 + randomNumberGenerator() % 10;
+            }
+            handBatch.addCardValuesToHands(cardValues.data());
+        }
+        long long numberOfEvaluations = (numberOfOperations + numberOfHands - 1) / numberOfHands;
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long evaluationIndex = 0; evaluationIndex < numberOfEvaluations; evaluationIndex++) {
+            keepBenchmarkedValue(handBatch);
+            handBatch.evaluateHands();
+            keepBenchmarkedValue(handBatch);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("HandBatch::evaluateHands", numberOfEvaluations * numberOfHands, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    void benchmarkAppendHandInTextFormat(long long numberOfOperations) {
+        Hand hand;
+        hand.addCardToHand(Card(Queen, Diamonds));
+        hand.addCardToHand(Card(Ace, Spades));
+        std::string textBuffer;
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex++) {
+            textBuffer.clear();
+            hand.appendHandInTextFormat(textBuffer);
+            keepBenchmarkedValue(textBuffer);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Hand::appendHandInTextFormat", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    void benchmarkGetCardInTextFormat(long long numberOfOperations) {
+        Card cards[52];
+        for (int cardIndex = 0; cardIndex < 52; cardIndex++) {
+            cards[cardIndex] = Card(static_cast<CardRank>(cardIndex % 13), static_cast<CardSuit>(cardIndex / 13));
+        }
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        for (long long operationIndex = 0; operationIndex < numberOfOperations; operationIndex++) {
+            const std::string& cardInTextFormat = cards[operationIndex % 52].getCardInTextFormat();
+            keepBenchmarkedValue(cardInTextFormat);
+        }
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        addBenchmarkResult("Card::getCardInTextFormat", numberOfOperations, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    void benchmarkHeadlessRounds(long long numberOfRounds, double penetration) {
+        SimulationEngine<BasicStrategyPlayerPolicy<>, Xoshiro256StarStarGenerator> simulationEngine(numberOfDecks, penetration);
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        SimulationResults simulationResults = simulationEngine.runRounds(numberOfRounds, 1);
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        keepBenchmarkedValue(simulationResults);
+        addBenchmarkResult("SimulationEngine::runRounds", numberOfRounds, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    // Each ruleset is its own engine, dealing from the decks of its rules, so
+    // house configurations are compared side by side.
+    template <typename HouseRules>
+    void benchmarkHeadlessRoundsWithHouseRules(long long numberOfRounds, double penetration) {
+        SimulationEngine<BasicStrategyPlayerPolicy<HouseRules>, Xoshiro256StarStarGenerator, HouseRules> simulationEngine(HouseRules::numberOfDecks, penetration);
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        SimulationResults simulationResults = simulationEngine.runRounds(numberOfRounds, 1);
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        keepBenchmarkedValue(simulationResults);
+        addBenchmarkResult(std::string("SimulationEngine::runRounds (") + HouseRules::rulesName + " rules)", numberOfRounds, elapsedTime,
+                           numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+    // Operations are hands played (i.e., rounds times seats).
+    void benchmarkHeadlessTableRounds(long long numberOfRounds, double penetration) {
+        SimulationEngine<BasicStrategyPlayerPolicy<>, Xoshiro256StarStarGenerator> simulationEngine(SeatLimits::maximumNumberOfSeats, numberOfDecks, penetration);
+        long long heapAllocationsBefore = numberOfHeapAllocationsOfThread;
+        BenchmarkClock::time_point startTime = BenchmarkClock::now();
+        SimulationResults simulationResults = simulationEngine.runRounds(numberOfRounds, 1);
+        BenchmarkClock::duration elapsedTime = BenchmarkClock::now() - startTime;
+        keepBenchmarkedValue(simulationResults);
+        addBenchmarkResult("SimulationEngine::runRounds (7 seats)", simulationResults.roundsPlayed, elapsedTime, numberOfHeapAllocationsOfThread - heapAllocationsBefore);
+    }
+
+public:
+    BenchmarkSuite(int decks) {
+        numberOfDecks = decks;
+        randomNumberGenerator.seed(1);
+    }
+
+    std::vector<BenchmarkResult> runBenchmarks(double penetration) {
+        benchmarkResults.clear();
+        benchmarkCreateOrderedDeck(1000000);
+        benchmarkShuffleDeck(1000000);
+        benchmarkDrawCardFromDeck(100000000);
+        benchmarkGetTrueCount(100000000);
+        benchmarkGetHandValue(100000000);
+        benchmarkAddCardToHand(100000000);
+        benchmarkEvaluateHandBatch(1000000000);
+        benchmarkGetCardInTextFormat(10000000);
+        benchmarkAppendHandInTextFormat(10000000);
+        benchmarkHeadlessRounds(10000000, penetration);
+        benchmarkHeadlessRoundsWithHouseRules<ClassicHouseRules>(10000000, penetration);
+        benchmarkHeadlessRoundsWithHouseRules<LasVegasStripHouseRules>(10000000, penetration);
+        benchmarkHeadlessRoundsWithHouseRules<DowntownHouseRules>(10000000, penetration);
+        benchmarkHeadlessTableRounds(2000000, penetration);
+        return benchmarkResults;
     }
 };
 
-int main() {
+class BenchmarkPresenter {
+public:
+    // 1 JSON object holding every result, e.g.
+    // {"benchmarks": [{"name": "Hand::getHandValue", "operations": 100000000, "ns_per_op": 0.3, "allocations_per_op": 0}]}
+    // (allocations_per_op is null unless the build counts allocations).
+    void displayBenchmarkResultsInJsonFormat(const std::vector<BenchmarkResult>& benchmarkResults, int numberOfDecks, double penetration) {
+        std::printf("{\"decks\": %d, \"penetration\": %g, \"benchmarks\": [", numberOfDecks, penetration);
+        for (std::size_t resultIndex = 0; resultIndex < benchmarkResults.size(); resultIndex++) {
+            const BenchmarkResult& benchmarkResult = benchmarkResults[resultIndex];
+            std::printf("%s\n  {\"name\": \"%s\", \"operations\": %lld, \"ns_per_op\": %.4f, \"allocations_per_op\": ",
+                        resultIndex == 0 ? "" : ",", benchmarkResult.benchmarkName.c_str(), benchmarkResult.numberOfOperations,
+                        benchmarkResult.nanosecondsPerOperation);
+            if (BLACKJACK_ALLOCATION_COUNTING) {
+                std::printf("%.4f}", benchmarkResult.heapAllocationsPerOperation);
+            } else {
+                std::printf("null}"); // allocations are not counted in this build
+            }
+        }
+        std::printf("\n]}\n");
+    }
+};
+
+// Usage:
+//     blackjack [--quiet]         interactive game (--quiet: nothing is displayed)
+//         [--rules NAME]          house rules: classic (default), vegas-strip or downtown
+//         [--script FILE]         answers of the player replayed from FILE, 1 per line
+//         [--seed S]              seed of the shuffles (default: random)
+//         [--round-log FILE]      every round is logged to FILE in binary format
+//     blackjack --simulate N      headless simulation of N rounds
+//         [--threads T]           number of simulation threads (default: all cores)
+//         [--seats S]             seats at the table, 1 to 7 (default: 1)
+//         [--tables T]            T tables of 1 seat hosted by 1 single-threaded event loop
+//         [--coroutines]          the tables are coroutines (CoroutineBlackjackGame)
+//         [--seed S]              seed of the simulation (default: random)
+//         [--rng NAME]            xoshiro256 (default) or mt19937_64
+//         [--player-policy NAME]  basic-strategy (default) or dealer-rule
+//         [--rules NAME]          house rules: classic (default), vegas-strip or downtown
+//         [--decks D]             number of decks in the dealing shoe, 1 to 8 (default: the
+//                                 decks of the house rules)
+//         [--penetration P]       fraction of the shoe dealt before reshuffling (default: 0,
+//                                 i.e., the shoe is reshuffled between each round)
+//         [--round-log FILE]      every round is logged to FILE in binary format
+//         [--checkpoint FILE]     the progress is saved to FILE, and a simulation found in
+//                                 FILE is resumed
+//         [--checkpoint-interval S]
+//                                 seconds between 2 saves of the checkpoint (default: 60)
+//         [--target-margin-of-error M]
+//                                 stop once the 95 % confidence interval of the house edge
+//                                 is within +/- M % (N is then the maximum number of rounds)
+//     blackjack --read-round-log FILE
+//                                 aggregate results of the rounds logged in FILE
+//     blackjack --benchmark [--decks D] [--penetration P]
+//                                 benchmarks of the game engine in JSON format
+//     blackjack --analyze-house-edge [--rules NAME] [--decks D] [--player-policy NAME] [--threads T]
+//                                 exact house edge, enumerating every draw from the full shoe
+//     blackjack --dealer-probabilities [--rules NAME] [--decks D]
+//                                 exact dealer outcome probabilities for each upcard
+struct CommandLineOptions {
+    // Upper bounds of the options that size the simulation.
+    static const int maximumNumberOfThreads = 1024;
+    static const int maximumNumberOfTables = 65536;
+
+    bool simulate;
+    bool displayDealerProbabilities;
+    bool analyzeHouseEdge;
+    bool runBenchmarks;
+    bool quiet;
+    std::string scriptFilePath;
+    std::string roundLogFilePath;
+    std::string roundLogFilePathToRead;
+    std::string checkpointFilePath;
+    int checkpointIntervalInSeconds;
+    double targetHouseEdgeMarginOfError; // 0: every round is played
+    long long numberOfRoundsToSimulate;
+    int numberOfThreads;
+    bool numberOfThreadsIsGiven;
+    int numberOfSeats;
+    int numberOfTables; // 0: no event loop
+    bool useCoroutines;
+    bool seedIsGiven;
+    std::uint64_t seed;
+    std::string randomNumberGeneratorName;
+    std::string playerPolicyName;
+    std::string houseRulesName;
+    int numberOfDecks; // 0: the decks of the house rules
+    double penetration;
+
+    CommandLineOptions() {
+        simulate = false;
+        displayDealerProbabilities = false;
+        analyzeHouseEdge = false;
+        runBenchmarks = false;
+        quiet = false;
+        checkpointIntervalInSeconds = 60;
+        targetHouseEdgeMarginOfError = 0.0;
+        numberOfRoundsToSimulate = 0;
+        numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+        numberOfThreadsIsGiven = false;
+        numberOfSeats = 1;
+        numberOfTables = 0;
+        useCoroutines = false;
+        seedIsGiven = false;
+        seed = 0;
+        randomNumberGeneratorName = "xoshiro256";
+        playerPolicyName = "basic-strategy";
+        houseRulesName = "classic";
+        numberOfDecks = 0;
+        penetration = 0.0;
+    }
+};
+
+long long parseNumberBetween(const std::string& text, long long minimumNumber, long long maximumNumber) {
+    long long number = minimumNumber - 1;
+    try {
+        std::size_t charactersParsed = 0;
+        number = std::stoll(text, &charactersParsed);
+        if (charactersParsed != text.size()) {
+            number = minimumNumber - 1;
+        }
+    }
+    catch (const std::exception& e) {
+        number = minimumNumber - 1;
+    }
+    if (number < minimumNumber || number > maximumNumber) {
+        throw CustomExceptionWithErrorMessage("Error: '" + text + "' is not a number between " + std::to_string(minimumNumber) +
+                                              " and " + std::to_string(maximumNumber) + ".");
+    }
+    return number;
+}
+
+std::uint64_t parseSeed(const std::string& text) {
+    bool seedIsValid = !text.empty() && text.find_first_not_of("0123456789") == std::string::npos;
+    std::uint64_t seed = 0;
+    try {
+        if (seedIsValid) {
+            seed = std::stoull(text);
+        }
+    }
+    catch (const std::exception& e) {
+        seedIsValid = false;
+    }
+    if (!seedIsValid) {
+        throw CustomExceptionWithErrorMessage("Error: '" + text + "' is not a valid seed.");
+    }
+    return seed;
+}
+
+double parsePenetration(const std::string& text) {
+    double penetration = -1.0;
+    try {
+        std::size_t charactersParsed = 0;
+        penetration = std::stod(text, &charactersParsed);
+        if (charactersParsed != text.size()) {
+            penetration = -1.0;
+        }
+    }
+    catch (const std::exception& e) {
+        penetration = -1.0;
+    }
+    if (!(penetration >= 0.0 && penetration <= 1.0)) {
+        throw CustomExceptionWithErrorMessage("Error: '" + text + "' is not a penetration between 0 and 1.");
+    }
+    return penetration;
+}
+
+// The margin of error is given in percent of the chips wagered, as the house
+// edge is displayed.
+double parseMarginOfError(const std::string& text) {
+    double marginOfErrorInPercent = -1.0;
     try {
-        BlackjackGame game;
+        std::size_t charactersParsed = 0;
+        marginOfErrorInPercent = std::stod(text, &charactersParsed);
+        if (charactersParsed != text.size()) {
+            marginOfErrorInPercent = -1.0;
+        }
+    }
+    catch (const std::exception& e) {
+        marginOfErrorInPercent = -1.0;
+    }
+    if (!(marginOfErrorInPercent > 0.0 && marginOfErrorInPercent <= 100.0)) {
+        throw CustomExceptionWithErrorMessage("Error: '" + text + "' is not a margin of error above 0 and up to 100 %.");
+    }
+    return marginOfErrorInPercent / 100.0;
+}
+
+CommandLineOptions parseCommandLineOptions(int argc, char* argv[]) {
+    CommandLineOptions options;
+    for (int argumentIndex = 1; argumentIndex < argc; argumentIndex++) {
+        std::string argument = argv[argumentIndex];
+        if (argument == "--simulate" && argumentIndex + 1 < argc) {
+            options.simulate = true;
+            options.numberOfRoundsToSimulate = parseNumberBetween(argv[++argumentIndex], 1, std::numeric_limits<long long>::max());
+        } else if (argument == "--script" && argumentIndex + 1 < argc) {
+            options.scriptFilePath = argv[++argumentIndex];
+        } else if (argument == "--round-log" && argumentIndex + 1 < argc) {
+            options.roundLogFilePath = argv[++argumentIndex];
+        } else if (argument == "--read-round-log" && argumentIndex + 1 < argc) {
+            options.roundLogFilePathToRead = argv[++argumentIndex];
+        } else if (argument == "--checkpoint" && argumentIndex + 1 < argc) {
+            options.checkpointFilePath = argv[++argumentIndex];
+        } else if (argument == "--checkpoint-interval" && argumentIndex + 1 < argc) {
+            options.checkpointIntervalInSeconds = parseNumberBetween(argv[++argumentIndex], 1, std::numeric_limits<int>::max());
+        } else if (argument == "--target-margin-of-error" && argumentIndex + 1 < argc) {
+            options.targetHouseEdgeMarginOfError = parseMarginOfError(argv[++argumentIndex]);
+        } else if (argument == "--quiet") {
+            options.quiet = true;
+        } else if (argument == "--benchmark") {
+            options.runBenchmarks = true;
+        } else if (argument == "--dealer-probabilities") {
+            options.displayDealerProbabilities = true;
+        } else if (argument == "--analyze-house-edge") {
+            options.analyzeHouseEdge = true;
+        } else if (argument == "--threads" && argumentIndex + 1 < argc) {
+            options.numberOfThreadsIsGiven = true;
+            options.numberOfThreads = parseNumberBetween(argv[++argumentIndex], 1, CommandLineOptions::maximumNumberOfThreads);
+        } else if (argument == "--seats" && argumentIndex + 1 < argc) {
+            options.numberOfSeats = parseNumberBetween(argv[++argumentIndex], SeatLimits::minimumNumberOfSeats, SeatLimits::maximumNumberOfSeats);
+        } else if (argument == "--coroutines") {
+            options.useCoroutines = true;
+        } else if (argument == "--tables" && argumentIndex + 1 < argc) {
+            options.numberOfTables = parseNumberBetween(argv[++argumentIndex], 1, CommandLineOptions::maximumNumberOfTables);
+        } else if (argument == "--seed" && argumentIndex + 1 < argc) {
+            options.seedIsGiven = true;
+            options.seed = parseSeed(argv[++argumentIndex]);
+        } else if (argument == "--decks" && argumentIndex + 1 < argc) {
+            options.numberOfDecks = parseNumberBetween(argv[++argumentIndex], Deck::minimumNumberOfDecksInShoe, Deck::maximumNumberOfDecksInShoe);
+        } else if (argument == "--penetration" && argumentIndex + 1 < argc) {
+            options.penetration = parsePenetration(argv[++argumentIndex]);
+        } else if (argument == "--player-policy" && argumentIndex + 1 < argc) {
+            options.playerPolicyName = argv[++argumentIndex];
+            if (options.playerPolicyName != "basic-strategy" && options.playerPolicyName != "dealer-rule") {
+                throw CustomExceptionWithErrorMessage("Error: unknown player policy '" + options.playerPolicyName + "'.");
+            }
+        } else if (argument == "--rules" && argumentIndex + 1 < argc) {
+            options.houseRulesName = argv[++argumentIndex];
+            if (options.houseRulesName != "classic" && options.houseRulesName != "vegas-strip" && options.houseRulesName != "downtown") {
+                throw CustomExceptionWithErrorMessage("Error: unknown house rules '" + options.houseRulesName + "'.");
+            }
+        } else if (argument == "--rng" && argumentIndex + 1 < argc) {
+            options.randomNumberGeneratorName = argv[++argumentIndex];
+            if (options.randomNumberGeneratorName != "xoshiro256" && options.randomNumberGeneratorName != "mt19937_64") {
+                throw CustomExceptionWithErrorMessage("Error: unknown random number generator '" + options.randomNumberGeneratorName + "'.");
+            }
+        } else {
+            throw CustomExceptionWithErrorMessage("Error: unknown or incomplete option '" + argument + "'.");
+        }
+    }
+    if (options.useCoroutines && options.numberOfTables == 0) {
+        throw CustomExceptionWithErrorMessage("Error: --coroutines needs the number of tables (--tables T).");
+    }
+    return options;
+}
+
+template <typename HouseRules>
+int getNumberOfDecks(const CommandLineOptions& options) {
+    if (options.numberOfDecks == 0) {
+        return HouseRules::numberOfDecks;
+    } else {
+        return options.numberOfDecks;
+    }
+}
+
+template <typename PlayerPolicy, typename RandomNumberGenerator, typename HouseRules>
+void runSimulation(const CommandLineOptions& options) {
+    // A resumed simulation keeps the seed of its checkpoint unless one is given.
+    std::unique_ptr<SimulationCheckpoint> simulationCheckpoint;
+    bool checkpointIsLoaded = false;
+    if (!options.checkpointFilePath.empty()) {
+        simulationCheckpoint.reset(new SimulationCheckpoint(options.checkpointFilePath, options.checkpointIntervalInSeconds));
+        checkpointIsLoaded = simulationCheckpoint->loadCheckpointFile();
+    }
+    std::uint64_t seed = options.seed;
+    if (!options.seedIsGiven && checkpointIsLoaded) {
+        seed = simulationCheckpoint->getSeed();
+    } else if (!options.seedIsGiven) {
+        std::random_device randomDevice;
+        seed = (static_cast<std::uint64_t>(randomDevice()) << 32) | randomDevice();
+    }
+    int numberOfDecks = getNumberOfDecks<HouseRules>(options);
+    SimulationPresenter simulationPresenter;
+    if (options.numberOfTables > 0) {
+        if (options.numberOfThreadsIsGiven) {
+            throw CustomExceptionWithErrorMessage("Error: the tables of an event loop are hosted by 1 thread (no --threads).");
+        }
+        if (options.numberOfSeats > 1) {
+            throw CustomExceptionWithErrorMessage("Error: the tables of an event loop have 1 seat (no --seats).");
+        }
+        if (!options.roundLogFilePath.empty()) {
+            throw CustomExceptionWithErrorMessage("Error: the tables of an event loop cannot be logged.");
+        }
+        if (simulationCheckpoint) {
+            throw CustomExceptionWithErrorMessage("Error: the tables of an event loop cannot be checkpointed.");
+        }
+        if (options.targetHouseEdgeMarginOfError > 0.0) {
+            throw CustomExceptionWithErrorMessage("Error: the tables of an event loop play every round (no target margin of error).");
+        }
+        simulationPresenter.displayEventLoopSettings(options.numberOfRoundsToSimulate, options.numberOfTables, options.useCoroutines, seed);
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        SimulationResults results;
+        if (options.useCoroutines) {
+            CoroutineGameSimulation<PlayerPolicy, RandomNumberGenerator, HouseRules> coroutineGameSimulation(options.numberOfTables, numberOfDecks, options.penetration);
+            results = coroutineGameSimulation.runRounds(options.numberOfRoundsToSimulate, seed);
+        } else {
+            EventLoopSimulation<PlayerPolicy, RandomNumberGenerator, HouseRules> eventLoopSimulation(options.numberOfTables, numberOfDecks, options.penetration);
+            results = eventLoopSimulation.runRounds(options.numberOfRoundsToSimulate, seed);
+        }
+        std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - startTime;
+        simulationPresenter.displaySimulationResults(results, elapsedTime.count(), 0);
+        return;
+    }
+    simulationPresenter.displaySimulationSettings(options.numberOfRoundsToSimulate, HouseRules::rulesName, numberOfDecks,
+                                                  options.numberOfSeats, options.numberOfThreads, seed);
+    ParallelSimulationRunner<PlayerPolicy, RandomNumberGenerator, HouseRules> simulationRunner(options.numberOfThreads, numberOfDecks, options.penetration);
+    simulationRunner.setNumberOfSeats(options.numberOfSeats);
+    simulationRunner.setTargetHouseEdgeMarginOfError(options.targetHouseEdgeMarginOfError);
+    if (options.targetHouseEdgeMarginOfError > 0.0) {
+        simulationPresenter.displayTargetMarginOfError(options.targetHouseEdgeMarginOfError, options.numberOfRoundsToSimulate);
+    }
+    long long roundsPlayedBeforeResuming = 0;
+    if (simulationCheckpoint) {
+        std::string simulationName = options.houseRulesName + " " + options.playerPolicyName + " " + options.randomNumberGeneratorName;
+        simulationCheckpoint->startSimulation(simulationName, seed, options.numberOfRoundsToSimulate,
+                                              simulationRunner.getNumberOfRoundsPerChunk(), numberOfDecks,
+                                              options.numberOfSeats, options.penetration, options.targetHouseEdgeMarginOfError);
+        roundsPlayedBeforeResuming = simulationCheckpoint->getResultsOfCompletedChunks().roundsPlayed;
+        if (checkpointIsLoaded) {
+            simulationPresenter.displayCheckpointResumption(options.checkpointFilePath, roundsPlayedBeforeResuming);
+        }
+        simulationRunner.setCheckpoint(simulationCheckpoint.get());
+    }
+    std::unique_ptr<RoundLogFile> roundLogFile;
+    if (!options.roundLogFilePath.empty()) {
+        simulationRunner.checkRoundLogIsAllowed();
+        roundLogFile.reset(new RoundLogFile(options.roundLogFilePath));
+        simulationRunner.setRoundLogFile(roundLogFile.get());
+    }
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    SimulationResults results = simulationRunner.runRounds(options.numberOfRoundsToSimulate, seed);
+    std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - startTime;
+    simulationPresenter.displaySimulationResults(results, elapsedTime.count(), roundsPlayedBeforeResuming);
+}
+
+template <typename PlayerPolicy, typename HouseRules>
+void runSimulationWithPlayerPolicy(const CommandLineOptions& options) {
+    if (options.randomNumberGeneratorName == "mt19937_64") {
+        runSimulation<PlayerPolicy, Mt19937_64Generator, HouseRules>(options);
+    } else {
+        runSimulation<PlayerPolicy, Xoshiro256StarStarGenerator, HouseRules>(options);
+    }
+}
+
+template <typename HouseRules>
+void runSimulationWithHouseRules(const CommandLineOptions& options) {
+    if (options.playerPolicyName == "dealer-rule") {
+        runSimulationWithPlayerPolicy<DealerRulePlayerPolicy<HouseRules>, HouseRules>(options);
+    } else {
+        runSimulationWithPlayerPolicy<BasicStrategyPlayerPolicy<HouseRules>, HouseRules>(options);
+    }
+}
+
+template <typename HouseRules>
+void displayDealerProbabilities(const CommandLineOptions& options) {
+    DealerProbabilityEngine<HouseRules> dealerProbabilityEngine;
+    SimulationPresenter simulationPresenter;
+    int numberOfDecks = getNumberOfDecks<HouseRules>(options);
+    simulationPresenter.displayDealerOutcomeProbabilitiesHeader(HouseRules::rulesName, numberOfDecks);
+    for (int upcardValue = 1; upcardValue <= 10; upcardValue++) {
+        ShoeComposition composition = ShoeComposition::createFullShoe(numberOfDecks);
+        composition.removeCardOfValue(upcardValue);
+        DealerOutcomeProbabilities outcomes = dealerProbabilityEngine.computeDealerOutcomeProbabilities(upcardValue, composition);
+        simulationPresenter.displayDealerOutcomeProbabilities(upcardValue, outcomes);
+    }
+    std::cout << std::flush;
+}
+
+// The benchmarks of the game engine play the classic rules, besides
+// SimulationEngine::runRounds for every ruleset.
+void runBenchmarks(const CommandLineOptions& options) {
+    int numberOfDecks = getNumberOfDecks<ClassicHouseRules>(options);
+    BenchmarkSuite benchmarkSuite(numberOfDecks);
+    std::vector<BenchmarkResult> benchmarkResults = benchmarkSuite.runBenchmarks(options.penetration);
+    BenchmarkPresenter benchmarkPresenter;
+    benchmarkPresenter.displayBenchmarkResultsInJsonFormat(benchmarkResults, numberOfDecks, options.penetration);
+}
+
+void readRoundLog(const CommandLineOptions& options) {
+    RoundLogReader roundLogReader(options.roundLogFilePathToRead);
+    SimulationPresenter simulationPresenter;
+    simulationPresenter.displayRoundLogSettings(options.roundLogFilePathToRead, roundLogReader.getNumberOfRecords());
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    SimulationResults results = roundLogReader.aggregateResults();
+    std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - startTime;
+    simulationPresenter.displaySimulationResults(results, elapsedTime.count(), 0);
+}
+
+template <typename HouseRules>
+void playInteractiveGame(const CommandLineOptions& options) {
+    BlackjackGame<BlackjackPresenter, Xoshiro256StarStarGenerator, HouseRules> game;
+    game.getPlayerPolicy().setQuietMode(options.quiet);
+    if (options.seedIsGiven) {
+        game.startNewSession(options.seed);
+    }
+    std::unique_ptr<RoundLogFile> roundLogFile;
+    std::unique_ptr<RoundLogWriter> roundLogWriter;
+    if (!options.roundLogFilePath.empty()) {
+        roundLogFile.reset(new RoundLogFile(options.roundLogFilePath));
+        roundLogWriter.reset(new RoundLogWriter(*roundLogFile, 0));
+        game.setRoundLogWriter(roundLogWriter.get());
+    }
+    if (options.scriptFilePath.empty()) {
+        game.beginPlaying();
+    } else {
+        ScriptedInputSource scriptedInputSource(options.scriptFilePath);
+        game.getPlayerPolicy().setPlayerInputSource(&scriptedInputSource);
         game.beginPlaying();
+        game.getPlayerPolicy().setPlayerInputSource(nullptr);
+    }
+    if (roundLogWriter) {
+        roundLogWriter->flushRecords();
+    }
+}
+
+template <typename PlayerPolicy, typename HouseRules>
+void analyzeHouseEdge(const CommandLineOptions& options) {
+    int numberOfDecks = getNumberOfDecks<HouseRules>(options);
+    HouseEdgeAnalyzer<PlayerPolicy, HouseRules> houseEdgeAnalyzer(numberOfDecks, options.numberOfThreads);
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    HouseEdgeAnalysis analysis = houseEdgeAnalyzer.analyzeHouseEdge();
+    std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - startTime;
+    SimulationPresenter simulationPresenter;
+    simulationPresenter.displayHouseEdgeAnalysis(HouseRules::rulesName, numberOfDecks, options.numberOfThreads, analysis, elapsedTime.count());
+}
+
+// Each ruleset compiles into its own game and engines.
+template <typename HouseRules>
+void playWithHouseRules(const CommandLineOptions& options) {
+    if (options.displayDealerProbabilities) {
+        displayDealerProbabilities<HouseRules>(options);
+    } else if (options.analyzeHouseEdge && options.playerPolicyName == "dealer-rule") {
+        analyzeHouseEdge<DealerRulePlayerPolicy<HouseRules>, HouseRules>(options);
+    } else if (options.analyzeHouseEdge) {
+        analyzeHouseEdge<BasicStrategyPlayerPolicy<HouseRules>, HouseRules>(options);
+    } else if (options.simulate) {
+        runSimulationWithHouseRules<HouseRules>(options);
+    } else {
+        playInteractiveGame<HouseRules>(options);
+    }
+}
+
+int main(int argc, char* argv[]) {
+#if BLACKJACK_INSTRUMENTATION
+    std::atexit(PhaseInstrumentation::dumpCountersInJsonFormat);
+#endif
+    try {
+        CommandLineOptions options = parseCommandLineOptions(argc, argv);
+        if (options.runBenchmarks) {
+            runBenchmarks(options);
+        } else if (!options.roundLogFilePathToRead.empty()) {
+            readRoundLog(options);
+        } else if (options.houseRulesName == "vegas-strip") {
+            playWithHouseRules<LasVegasStripHouseRules>(options);
+        } else if (options.houseRulesName == "downtown") {
+            playWithHouseRules<DowntownHouseRules>(options);
+        } else {
+            playWithHouseRules<ClassicHouseRules>(options);
+        }
     }
     catch (const CustomExceptionWithErrorMessage& e) {
         std::cout << std::endl;